@@ -0,0 +1,606 @@
+// Host tool rendering every wave pair x coupling x cutoff x envelope through
+// synth.c built with BEEP_HOST. Variants are taken from a shared work queue by
+// one worker process per core, each with its own synth state, and written as
+// WAV or 8SVX files with an index.csv describing them. Optionally checks that
+// each variant's Fibonacci-delta compression decodes with the error the
+// encoder reports, or measures the signal to quantization noise ratio with
+// and without the output stage's error-feedback dither.
+
+#include "common.h"
+#include "synth.h"
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define kDefRateIdx 24 // C-3
+#define kDefOctaveBase 3
+#define kDefLengthMs 750
+#define kDefCutoffSteps 8
+#define kDefOscMix 50
+#define kDefOscDetune 12
+#define kNumSweepWaves Wave_Custom // custom wave has no points to sweep
+#define kPathMaxLen 0x200
+#define kChanStereo 6 // left (2) | right (4)
+#define kUnityVolume 0x10000
+#define kMidiNoteC4 60 // smpl unity note, the sample plays at its own pitch at its rate
+#define kSnrBandHz 4000 // in-band noise is measured below this
+
+typedef enum {
+  FileFormat_WAV, FileFormat_8SVX, kNumFileFormats
+} FileFormat;
+
+typedef struct {
+  STRPTR name;
+  Envelope env;
+} EnvPreset;
+
+typedef struct {
+  Wave osc1_wave;
+  Wave osc2_wave;
+  Couple couple;
+  UWORD cutoff;
+  UWORD env_idx;
+} Variant;
+
+// Written by the workers, read by the parent for the index once they exit.
+typedef struct {
+  BOOL ok;
+  BOOL stereo;
+  ULONG num_samples;
+  ULONG loop_start;
+  UWORD fib_max_err;
+  ULONG fib_sq_err;
+  double sig_pow; // left channel before quantization, squared and summed
+  double err_pow[2]; // quantization error without and with dither
+  double band_err_pow[2]; // same below kSnrBandHz
+} Result;
+
+typedef struct {
+  ULONG next_job;
+  Result results[];
+} Queue;
+
+static STRPTR WaveNames[] = { "square", "sawtooth", "triangle", "noise", "custom" };
+static STRPTR CoupleNames[] = { "mix", "sync", "ring" };
+static STRPTR FileExts[] = { ".wav", ".8svx" };
+
+static EnvPreset EnvPresets[] = {
+  { "default", { kUByteMax / 5, kUByteMax / 10, (kUByteMax / 2) + 5, kUByteMax / 5 } },
+  { "pluck", { 2, 60, 0, 10 } },
+  { "pad", { 120, 30, 200, 80 } },
+  { "swell", { 220, 0, kUByteMax, 20 } },
+};
+
+static struct {
+  STRPTR out_dir;
+  FileFormat format;
+  UWORD num_workers;
+  UWORD cutoff_steps;
+  UWORD rate_idx;
+  UWORD length_ms;
+  BOOL fib_check;
+  BOOL snr_check;
+  ULONG num_jobs;
+  Queue* queue;
+  ULONG queue_size;
+} g;
+
+static Variant variant_from_job(ULONG job) {
+  Variant variant;
+
+  variant.env_idx = job % ARRAY_SIZE(EnvPresets);
+  job /= ARRAY_SIZE(EnvPresets);
+  UWORD step = job % g.cutoff_steps;
+  variant.cutoff = kMinCutoff + ((g.cutoff_steps > 1) ? ((kMaxCutoff - kMinCutoff) * step) / (g.cutoff_steps - 1) : 0);
+  job /= g.cutoff_steps;
+  variant.couple = job % kNumCouples;
+  job /= kNumCouples;
+  variant.osc2_wave = job % kNumSweepWaves;
+  variant.osc1_wave = job / kNumSweepWaves;
+
+  return variant;
+}
+
+static VOID make_path(BYTE path[kPathMaxLen],
+                      ULONG job) {
+  snprintf((char*)path, kPathMaxLen, "%s/beep_%05u%s", g.out_dir, job, FileExts[g.format]);
+}
+
+static UWORD rate_freq() {
+  return DIV_ROUND_NEAREST(kClockFreqPAL, PTNotePeriods[g.rate_idx / 12][g.rate_idx % 12]);
+}
+
+static VOID put_le(FILE* file,
+                   ULONG value,
+                   UWORD size_b) {
+  for (UWORD i = 0; i < size_b; ++ i) {
+    fputc((value >> (i * kBitsPerByte)) & kUByteMax, file);
+  }
+}
+
+static VOID put_be(FILE* file,
+                   ULONG value,
+                   UWORD size_b) {
+  for (UWORD i = size_b; i > 0; -- i) {
+    fputc((value >> ((i - 1) * kBitsPerByte)) & kUByteMax, file);
+  }
+}
+
+// 8-bit WAV is unsigned with interleaved channels.
+// A smpl chunk carries the loop for samplers that read it.
+static VOID write_wav(FILE* file,
+                      BYTE* samples,
+                      BYTE* samples_right,
+                      ULONG num_samples,
+                      ULONG loop_start) {
+  UWORD num_chans = samples_right ? 2 : 1;
+  ULONG data_size = num_samples * num_chans;
+  BOOL loop = loop_start < num_samples;
+  ULONG smpl_size = loop ? (9 * 4) + (6 * 4) : 0;
+  ULONG riff_size = 4 + (8 + 16) + (8 + data_size + (data_size & 1)) + (loop ? (8 + smpl_size) : 0);
+
+  fwrite("RIFF", 1, 4, file);
+  put_le(file, riff_size, 4);
+  fwrite("WAVEfmt ", 1, 8, file);
+  put_le(file, 16, 4);
+  put_le(file, 1, 2); // PCM
+  put_le(file, num_chans, 2);
+  put_le(file, rate_freq(), 4);
+  put_le(file, rate_freq() * num_chans, 4);
+  put_le(file, num_chans, 2);
+  put_le(file, kBitsPerByte, 2);
+
+  fwrite("data", 1, 4, file);
+  put_le(file, data_size, 4);
+
+  for (ULONG i = 0; i < num_samples; ++ i) {
+    fputc((UBYTE)(samples[i] + 0x80), file);
+
+    if (samples_right) {
+      fputc((UBYTE)(samples_right[i] + 0x80), file);
+    }
+  }
+
+  if (data_size & 1) {
+    fputc(0, file);
+  }
+
+  if (loop) {
+    fwrite("smpl", 1, 4, file);
+    put_le(file, smpl_size, 4);
+    put_le(file, 0, 4); // manufacturer
+    put_le(file, 0, 4); // product
+    put_le(file, 1000000000 / rate_freq(), 4); // nanoseconds per sample
+    put_le(file, kMidiNoteC4, 4);
+    put_le(file, 0, 4); // pitch fraction
+    put_le(file, 0, 4); // SMPTE format
+    put_le(file, 0, 4); // SMPTE offset
+    put_le(file, 1, 4); // loops
+    put_le(file, 0, 4); // sampler data
+    put_le(file, 0, 4); // cue point
+    put_le(file, 0, 4); // forward loop
+    put_le(file, loop_start, 4);
+    put_le(file, num_samples - 1, 4);
+    put_le(file, 0, 4); // fraction
+    put_le(file, 0, 4); // play forever
+  }
+}
+
+// Same layout as the exporter's uncompressed 8SVX, right channel after the left.
+static VOID write_8svx(FILE* file,
+                       BYTE* samples,
+                       BYTE* samples_right,
+                       ULONG num_samples,
+                       ULONG loop_start) {
+  ULONG body_size = samples_right ? (2 * num_samples) : num_samples;
+  ULONG chan_size = samples_right ? (8 + 4) : 0;
+
+  fwrite("FORM", 1, 4, file);
+  put_be(file, 4 + (8 + 20) + chan_size + 8 + body_size + (body_size & 1), 4);
+  fwrite("8SVXVHDR", 1, 8, file);
+  put_be(file, 20, 4);
+  put_be(file, loop_start, 4);
+  put_be(file, num_samples - loop_start, 4);
+  put_be(file, 0, 4);
+  put_be(file, rate_freq(), 2);
+  put_be(file, 1, 1);
+  put_be(file, 0, 1);
+  put_be(file, kUnityVolume, 4);
+
+  if (samples_right) {
+    fwrite("CHAN", 1, 4, file);
+    put_be(file, 4, 4);
+    put_be(file, kChanStereo, 4);
+  }
+
+  fwrite("BODY", 1, 4, file);
+  put_be(file, body_size, 4);
+  fwrite(samples, 1, num_samples, file);
+
+  if (samples_right) {
+    fwrite(samples_right, 1, num_samples, file);
+  }
+
+  if (body_size & 1) {
+    fputc(0, file);
+  }
+}
+
+// Expands Fibonacci-delta data the way an 8SVX reader does, each code's step
+// added to the running value starting from the initial one.
+static VOID fib_delta_decode(UBYTE* in,
+                             ULONG num_samples,
+                             BYTE* out) {
+  BYTE value = in[1];
+
+  in += kFibDeltaHdrSize;
+
+  for (ULONG i = 0; i < num_samples; ++ i) {
+    UWORD code = (i & 1) ? (in[i / 2] & 0xF) : (in[i / 2] >> 4);
+    value += FibDeltas[code];
+    out[i] = value;
+  }
+}
+
+// Round trip of one channel, the decoded error must match what the encoder
+// reports, which the exporter prints when saving compressed 8SVX.
+static BOOL check_fib_delta(BYTE* samples,
+                            ULONG num_samples,
+                            Result* result) {
+  BOOL ret = TRUE;
+  UBYTE* packed = NULL;
+  BYTE* decoded = NULL;
+  UWORD enc_max_err = 0;
+  ULONG enc_sq_err = 0;
+  UWORD max_err = 0;
+  ULONG sq_err = 0;
+
+  CHECK(packed = malloc(kFibDeltaHdrSize + (num_samples / 2)));
+  CHECK(decoded = malloc(num_samples));
+
+  fib_delta_encode(samples, num_samples, packed, &enc_max_err, &enc_sq_err);
+  fib_delta_decode(packed, num_samples, decoded);
+
+  for (ULONG i = 0; i < num_samples; ++ i) {
+    UWORD err = ABS(samples[i] - decoded[i]);
+    max_err = MAX(max_err, err);
+    sq_err += err * err;
+  }
+
+  CHECK(max_err == enc_max_err && sq_err == enc_sq_err);
+
+  result->fib_max_err = MAX(result->fib_max_err, max_err);
+  result->fib_sq_err += sq_err;
+
+cleanup:
+  free(decoded);
+  free(packed);
+
+  return ret;
+}
+
+// Mirrors model.c rendering the patch at its own rate note.
+static BOOL generate(Synth* synth,
+                     Variant* variant,
+                     BOOL dither,
+                     BYTE** out_samples,
+                     BYTE** out_samples_right,
+                     Result* result) {
+  BYTE custom_wave[kCustomWavePoints] = { 0 };
+  UWORD osc1_total_semis = ((kDefOctaveBase + (g.rate_idx / 12)) * 12) + (g.rate_idx % 12);
+  UWORD osc2_total_semis = osc1_total_semis + kDefOscDetune;
+
+  return synth_generate(synth, variant->osc1_wave, variant->osc2_wave, custom_wave, kDefOscMix, variant->couple,
+                        rate_freq(), osc_freq_from_semis(osc1_total_semis), osc_freq_from_semis(osc2_total_semis),
+                        FALSE, 1, 0, g.length_ms, variant->cutoff, Shape_Off, db_scale_lookup(0),
+                        FALSE, dither, Stereo_Off, 0, &EnvPresets[variant->env_idx].env,
+                        out_samples, out_samples_right, &result->num_samples, &result->loop_start);
+}
+
+// Quantization error of the left channel against the synth's unquantized
+// output, over the whole band and through a Butterworth low-pass at kSnrBandHz,
+// where the dither's first-order noise shaping should lower it.
+static VOID measure_noise(BYTE* samples,
+                          LONG* exact,
+                          ULONG num_samples,
+                          BOOL dither,
+                          Result* result) {
+  double w0 = (2 * M_PI * kSnrBandHz) / rate_freq();
+  double alpha = sin(w0) / (2 * M_SQRT1_2);
+  double a0 = 1 + alpha;
+  double b0 = ((1 - cos(w0)) / 2) / a0;
+  double b1 = (1 - cos(w0)) / a0;
+  double a1 = (-2 * cos(w0)) / a0;
+  double a2 = (1 - alpha) / a0;
+  double x1 = 0;
+  double x2 = 0;
+  double y1 = 0;
+  double y2 = 0;
+
+  double sig_pow = 0;
+
+  result->err_pow[dither] = 0;
+  result->band_err_pow[dither] = 0;
+
+  for (ULONG i = 0; i < num_samples; ++ i) {
+    double value = exact[i] / (double)(1UL << kBitsPerWord);
+    double err = samples[i] - value;
+    double y = (b0 * (err + x2)) + (b1 * x1) - (a1 * y1) - (a2 * y2);
+
+    x2 = x1;
+    x1 = err;
+    y2 = y1;
+    y1 = y;
+
+    sig_pow += value * value;
+    result->err_pow[dither] += err * err;
+    result->band_err_pow[dither] += y * y;
+  }
+
+  result->sig_pow = sig_pow;
+}
+
+// Renders the variant again with dither on, the unquantized output is the
+// same for both renders. Dither can move the loop, so both are measured over
+// the length of the first and the index keeps its loop.
+static BOOL check_snr(Synth* synth,
+                      Variant* variant,
+                      BYTE* samples,
+                      LONG* exact,
+                      Result* result) {
+  BOOL ret = TRUE;
+  BYTE* samples_right;
+  Result dithered;
+
+  measure_noise(samples, exact, result->num_samples, FALSE, result);
+  CHECK(generate(synth, variant, TRUE, &samples, &samples_right, &dithered));
+  measure_noise(samples, exact, result->num_samples, TRUE, result);
+
+cleanup:
+  return ret;
+}
+
+static BOOL render_job(Synth* synth,
+                       ULONG job) {
+  BOOL ret = TRUE;
+  FILE* file = NULL;
+  Variant variant = variant_from_job(job);
+  Result* result = &g.queue->results[job];
+  LONG* exact = NULL;
+  BYTE path[kPathMaxLen];
+  BYTE* samples;
+  BYTE* samples_right;
+
+  if (g.snr_check) {
+    CHECK(exact = malloc(synth_num_samples(rate_freq(), g.length_ms) * sizeof(LONG)));
+  }
+
+  synth_host_exact = exact;
+  CHECK(generate(synth, &variant, FALSE, &samples, &samples_right, result));
+
+  make_path(path, job);
+  CHECK(file = fopen((char*)path, "wb"));
+
+  if (g.format == FileFormat_WAV) {
+    write_wav(file, samples, samples_right, result->num_samples, result->loop_start);
+  }
+  else {
+    write_8svx(file, samples, samples_right, result->num_samples, result->loop_start);
+  }
+
+  CHECK(! ferror(file));
+
+  if (g.fib_check) {
+    CHECK(check_fib_delta(samples, result->num_samples, result));
+
+    if (samples_right) {
+      CHECK(check_fib_delta(samples_right, result->num_samples, result));
+    }
+  }
+
+  if (g.snr_check) {
+    CHECK(check_snr(synth, &variant, samples, exact, result));
+  }
+
+  result->stereo = samples_right != NULL;
+  result->ok = TRUE;
+
+cleanup:
+  if (file && fclose(file) != 0) {
+    ret = FALSE;
+  }
+
+  synth_host_exact = NULL;
+  free(exact);
+
+  return ret;
+}
+
+// Takes jobs until the queue is empty, the counter is shared by all workers.
+static BOOL run_worker() {
+  BOOL ret = TRUE;
+  Synth* synth = NULL;
+
+  CHECK(synth = synth_create());
+
+  for (;;) {
+    ULONG job = __atomic_fetch_add(&g.queue->next_job, 1, __ATOMIC_RELAXED);
+
+    if (job >= g.num_jobs) {
+      break;
+    }
+
+    ret &= render_job(synth, job);
+  }
+
+cleanup:
+  if (synth) {
+    synth_delete(synth);
+  }
+
+  return ret;
+}
+
+static BOOL write_index() {
+  BOOL ret = TRUE;
+  FILE* file = NULL;
+  BYTE path[kPathMaxLen];
+
+  snprintf((char*)path, kPathMaxLen, "%s/index.csv", g.out_dir);
+  CHECK(file = fopen((char*)path, "w"));
+
+  fprintf(file, "file,osc1_wave,osc2_wave,couple,cutoff,envelope,attack,decay,sustain,release,"
+                "rate,length_ms,num_samples,loop_start,stereo\n");
+
+  for (ULONG job = 0; job < g.num_jobs; ++ job) {
+    Variant variant = variant_from_job(job);
+    Result* result = &g.queue->results[job];
+    EnvPreset* preset = &EnvPresets[variant.env_idx];
+
+    if (! result->ok) {
+      continue;
+    }
+
+    make_path(path, job);
+    fprintf(file, "%s,%s,%s,%s,%u,%s,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+            (char*)path + str_len(g.out_dir) + 1, WaveNames[variant.osc1_wave], WaveNames[variant.osc2_wave],
+            CoupleNames[variant.couple], variant.cutoff, preset->name,
+            preset->env.attack, preset->env.decay, preset->env.sustain, preset->env.release,
+            rate_freq(), g.length_ms, result->num_samples, result->loop_start, result->stereo);
+  }
+
+  CHECK(! ferror(file));
+
+cleanup:
+  if (file && fclose(file) != 0) {
+    ret = FALSE;
+  }
+
+  return ret;
+}
+
+static BOOL parse_args(int argc,
+                       char** argv) {
+  BOOL ret = TRUE;
+  int opt;
+
+  g.out_dir = ".";
+  g.format = FileFormat_WAV;
+  g.num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+  g.cutoff_steps = kDefCutoffSteps;
+  g.rate_idx = kDefRateIdx;
+  g.length_ms = kDefLengthMs;
+
+  while ((opt = getopt(argc, argv, "o:f:j:c:r:l:zs")) != -1) {
+    switch (opt) {
+    case 'o': g.out_dir = optarg; break;
+    case 'f': g.format = (optarg[0] == '8') ? FileFormat_8SVX : FileFormat_WAV; break;
+    case 'j': g.num_workers = atoi(optarg); break;
+    case 'c': g.cutoff_steps = atoi(optarg); break;
+    case 'r': g.rate_idx = atoi(optarg); break;
+    case 'l': g.length_ms = atoi(optarg); break;
+    case 'z': g.fib_check = TRUE; break;
+    case 's': g.snr_check = TRUE; break;
+    default: CHECK(FALSE);
+    }
+  }
+
+  CHECK(g.num_workers >= 1);
+  CHECK(g.cutoff_steps >= 1);
+  CHECK(g.rate_idx <= kMaxSampleRateIdx);
+  CHECK(g.length_ms >= kMinLengthMs && g.length_ms <= kMaxLengthMs);
+
+cleanup:
+  if (! ret) {
+    fprintf(stderr, "usage: beepbatch [-o dir] [-f wav|8svx] [-j workers] [-c cutoff_steps] "
+                    "[-r rate_idx] [-l length_ms] [-z] [-s]\n");
+  }
+
+  return ret;
+}
+
+int main(int argc,
+         char** argv) {
+  BOOL ret = TRUE;
+  UWORD num_started = 0;
+
+  CHECK(parse_args(argc, argv));
+
+  g.num_jobs = kNumSweepWaves * kNumSweepWaves * kNumCouples * g.cutoff_steps * ARRAY_SIZE(EnvPresets);
+  g.queue_size = sizeof(Queue) + (g.num_jobs * sizeof(Result));
+  g.queue = mmap(NULL, g.queue_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  CHECK(g.queue != MAP_FAILED);
+
+  // Workers fork after synth_init, sharing only the queue.
+  CHECK(synth_init());
+
+  for (; num_started < g.num_workers; ++ num_started) {
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+
+    if (pid == 0) {
+      _exit(run_worker() ? 0 : 1);
+    }
+  }
+
+cleanup:
+  for (; num_started > 0; -- num_started) {
+    int status;
+
+    if (wait(&status) < 0 || ! WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      ret = FALSE;
+    }
+  }
+
+  if (g.queue && g.queue != MAP_FAILED) {
+    ret &= write_index();
+
+    ULONG num_rendered = 0;
+    UWORD fib_max_err = 0;
+    double fib_sq_err = 0;
+    double num_fib_samples = 0;
+    double sig_pow = 0;
+    double err_pow[2] = { 0, 0 };
+    double band_err_pow[2] = { 0, 0 };
+
+    for (ULONG job = 0; job < g.num_jobs; ++ job) {
+      Result* result = &g.queue->results[job];
+
+      num_rendered += result->ok;
+
+      if (result->ok) {
+        fib_max_err = MAX(fib_max_err, result->fib_max_err);
+        fib_sq_err += result->fib_sq_err;
+        num_fib_samples += (result->stereo ? 2 : 1) * (double)result->num_samples;
+        sig_pow += result->sig_pow;
+
+        for (UWORD dither = 0; dither < 2; ++ dither) {
+          err_pow[dither] += result->err_pow[dither];
+          band_err_pow[dither] += result->band_err_pow[dither];
+        }
+      }
+    }
+
+    printf("beepbatch: %u of %u variants rendered by %u workers\n", num_rendered, g.num_jobs, g.num_workers);
+
+    // A variant whose round trip didn't match wasn't rendered.
+    if (g.fib_check && num_rendered == g.num_jobs) {
+      printf("beepbatch: fibdelta round trip matches, max error %u, rms error %.1f\n",
+             fib_max_err, sqrt(fib_sq_err / num_fib_samples));
+    }
+
+    // Powers are summed over all variants, so loud ones weigh more.
+    if (g.snr_check && num_rendered > 0) {
+      printf("beepbatch: snr dither off/on %.1f/%.1f dB, below %u Hz %.1f/%.1f dB\n",
+             10 * log10(sig_pow / err_pow[0]), 10 * log10(sig_pow / err_pow[1]), kSnrBandHz,
+             10 * log10(sig_pow / band_err_pow[0]), 10 * log10(sig_pow / band_err_pow[1]));
+    }
+    munmap(g.queue, g.queue_size);
+  }
+
+  return ret ? 0 : 1;
+}
@@ -0,0 +1,239 @@
+#include "beeplib.h"
+#include "synth.h"
+
+#include <exec/execbase.h>
+#include <exec/libraries.h>
+#include <exec/resident.h>
+#include <proto/exec.h>
+
+#define kLibRevision 0
+#define kLibIdString "beep.library 1.0 (19.10.2026)"
+#define kDefRateFreq 16574 // C-3 on PAL
+#define kDefOsc1Freq (4186 << (kBitsPerWord - 3)) // C-5, C-8 / 8
+#define kDefOsc2Freq (4186 << (kBitsPerWord - 2)) // C-6, detuned by an octave
+
+#define REG(reg, arg) arg __asm(#reg)
+
+typedef struct {
+  struct Library lib;
+  BPTR seg_list;
+} BeepBase;
+
+typedef struct {
+  LONG min;
+  LONG max;
+  LONG def;
+} ParamRange;
+
+// One per BeepCreateContext(), nothing is shared between contexts but
+// read-only tables.
+typedef struct {
+  Synth* synth;
+  LONG params[kNumBeepParams];
+  BYTE custom_wave[kCustomWavePoints];
+} Context;
+
+struct ExecBase* SysBase;
+struct DosLibrary* DOSBase; // never opened, print_error() stays quiet
+
+static const ParamRange ParamRanges[kNumBeepParams] = {
+  [BeepParam_Osc1Wave] = { 0, kNumWaves - 1, Wave_Square },
+  [BeepParam_Osc2Wave] = { 0, kNumWaves - 1, Wave_Sawtooth },
+  [BeepParam_OscMix] = { 0, 100, 50 },
+  [BeepParam_OscCouple] = { 0, kNumCouples - 1, Couple_Mix },
+  [BeepParam_RateFreq] = { 1000, kWordMax, kDefRateFreq },
+  [BeepParam_Osc1Freq] = { 1 << kBitsPerWord, 0x3FFF << kBitsPerWord, kDefOsc1Freq },
+  [BeepParam_Osc2Freq] = { 1 << kBitsPerWord, 0x3FFF << kBitsPerWord, kDefOsc2Freq },
+  [BeepParam_FineTune] = { 0, 1, FALSE },
+  [BeepParam_UnisonVoices] = { 1, kMaxUnisonVoices, 1 },
+  [BeepParam_UnisonSpread] = { 0, 2 * kCentScaleRange, 48 },
+  [BeepParam_LengthMs] = { kMinLengthMs, kMaxLengthMs, 750 },
+  [BeepParam_Cutoff] = { kMinCutoff, kMaxCutoff, 1100 },
+  [BeepParam_Shape] = { 0, kNumShapes - 1, Shape_Off },
+  [BeepParam_GainDb] = { 0, kDbScaleRange * 10, 0 },
+  [BeepParam_Normalize] = { 0, 1, FALSE },
+  [BeepParam_Dither] = { 0, 1, FALSE },
+  [BeepParam_Stereo] = { 0, kNumStereoModes - 1, Stereo_Off },
+  [BeepParam_StereoWidth] = { 0, 100, 50 },
+  [BeepParam_EnvAttack] = { 0, kUByteMax, kUByteMax / 5 },
+  [BeepParam_EnvDecay] = { 0, kUByteMax, kUByteMax / 10 },
+  [BeepParam_EnvSustain] = { 0, kUByteMax, (kUByteMax / 2) + 5 },
+  [BeepParam_EnvRelease] = { 1, kUByteMax, kUByteMax / 5 },
+};
+
+// Running the library as a program returns straight away.
+LONG lib_start() {
+  return -1;
+}
+
+static BeepBase* lib_init(REG(d0, BeepBase* base),
+                          REG(a0, BPTR seg_list),
+                          REG(a6, struct ExecBase* sys_base)) {
+  SysBase = sys_base;
+
+  base->lib.lib_Node.ln_Type = NT_LIBRARY;
+  base->lib.lib_Node.ln_Name = kBeepLibName;
+  base->lib.lib_Flags = LIBF_SUMUSED | LIBF_CHANGED;
+  base->lib.lib_Version = kBeepLibVersion;
+  base->lib.lib_Revision = kLibRevision;
+  base->lib.lib_IdString = kLibIdString;
+  base->seg_list = seg_list;
+
+  // Oscillator tables are filled once and only read by the contexts.
+  synth_init();
+
+  return base;
+}
+
+static BPTR lib_expunge(REG(a6, BeepBase* base)) {
+  if (base->lib.lib_OpenCnt) {
+    base->lib.lib_Flags |= LIBF_DELEXP;
+    return 0;
+  }
+
+  BPTR seg_list = base->seg_list;
+
+  Remove(&base->lib.lib_Node);
+  FreeMem((UBYTE*)base - base->lib.lib_NegSize, base->lib.lib_NegSize + base->lib.lib_PosSize);
+
+  return seg_list;
+}
+
+static BeepBase* lib_open(REG(a6, BeepBase* base)) {
+  ++ base->lib.lib_OpenCnt;
+  base->lib.lib_Flags &= ~LIBF_DELEXP;
+
+  return base;
+}
+
+// Clients delete their contexts before closing, the library doesn't track them.
+static BPTR lib_close(REG(a6, BeepBase* base)) {
+  if (-- base->lib.lib_OpenCnt == 0 && (base->lib.lib_Flags & LIBF_DELEXP)) {
+    return lib_expunge(base);
+  }
+
+  return 0;
+}
+
+static LONG lib_null() {
+  return 0;
+}
+
+static VOID beep_delete_context(REG(a0, Context* context)) {
+  if (context) {
+    if (context->synth) {
+      synth_delete(context->synth);
+    }
+
+    FreeMem(context, sizeof(Context));
+  }
+}
+
+static Context* beep_create_context() {
+  BOOL ret = TRUE;
+  Context* context = NULL;
+
+  CHECK(context = (Context*)AllocMem(sizeof(Context), MEMF_CLEAR));
+  CHECK(context->synth = synth_create());
+
+  for (BeepParam param = 0; param < kNumBeepParams; ++ param) {
+    context->params[param] = ParamRanges[param].def;
+  }
+
+  // Custom wave starts out as one cycle of a sine, as in the UI.
+  for (UWORD i = 0; i < kCustomWavePoints; ++ i) {
+    context->custom_wave[i] = sin_lookup((i * kSinTableSize) / kCustomWavePoints) >> kBitsPerByte;
+  }
+
+cleanup:
+  if (! ret) {
+    beep_delete_context(context);
+    context = NULL;
+  }
+
+  return context;
+}
+
+// Out of range values are rejected and leave the parameter unchanged.
+static BOOL beep_set_param(REG(a0, Context* context),
+                           REG(d0, ULONG param),
+                           REG(d1, LONG value)) {
+  if (param >= kNumBeepParams || value < ParamRanges[param].min || value > ParamRanges[param].max) {
+    return FALSE;
+  }
+
+  context->params[param] = value;
+
+  return TRUE;
+}
+
+static LONG beep_get_param(REG(a0, Context* context),
+                           REG(d0, ULONG param)) {
+  return (param < kNumBeepParams) ? context->params[param] : 0;
+}
+
+static VOID beep_set_custom_wave(REG(a0, Context* context),
+                                 REG(a1, BYTE* points)) {
+  CopyMem(points, context->custom_wave, sizeof(context->custom_wave));
+}
+
+// Bytes per channel BeepRender() writes, stereo needs a second buffer this size.
+static ULONG beep_get_render_size(REG(a0, Context* context)) {
+  return synth_num_samples(context->params[BeepParam_RateFreq], context->params[BeepParam_LengthMs]);
+}
+
+// Returns the number of samples per channel after the loop cut, 0 if a stereo
+// render has no right buffer or the envelope segments don't fit the length.
+// Samples from loop_start onward loop seamlessly.
+static ULONG beep_render(REG(a0, Context* context),
+                         REG(a1, BYTE* samples),
+                         REG(a2, BYTE* samples_right),
+                         REG(a3, ULONG* loop_start)) {
+  LONG* params = context->params;
+  Envelope amp_env = {
+    params[BeepParam_EnvAttack], params[BeepParam_EnvDecay],
+    params[BeepParam_EnvSustain], params[BeepParam_EnvRelease]
+  };
+  ULONG num_samples;
+
+  // Segments are set one at a time, so only a render can check they fit in order.
+  if (! amp_env.release || amp_env.attack + amp_env.decay > kUByteMax - amp_env.release) {
+    return 0;
+  }
+
+  if (params[BeepParam_Stereo] == Stereo_Off) {
+    samples_right = NULL;
+  }
+  else if (! samples_right) {
+    return 0;
+  }
+
+  synth_render(context->synth, params[BeepParam_Osc1Wave], params[BeepParam_Osc2Wave], context->custom_wave,
+               params[BeepParam_OscMix], params[BeepParam_OscCouple], params[BeepParam_RateFreq],
+               params[BeepParam_Osc1Freq], params[BeepParam_Osc2Freq], params[BeepParam_FineTune],
+               params[BeepParam_UnisonVoices], params[BeepParam_UnisonSpread], params[BeepParam_LengthMs],
+               params[BeepParam_Cutoff], params[BeepParam_Shape],
+               db_scale_lookup(params[BeepParam_GainDb] / (10 / kDbScaleSteps)),
+               params[BeepParam_Normalize], params[BeepParam_Dither], params[BeepParam_Stereo],
+               params[BeepParam_StereoWidth], &amp_env, samples, samples_right, &num_samples, loop_start);
+
+  return num_samples;
+}
+
+// Standard vectors first, then the functions in beep_lib.fd order.
+static const APTR LibFuncs[] = {
+  (APTR)lib_open, (APTR)lib_close, (APTR)lib_expunge, (APTR)lib_null,
+  (APTR)beep_create_context, (APTR)beep_delete_context, (APTR)beep_set_param, (APTR)beep_get_param,
+  (APTR)beep_set_custom_wave, (APTR)beep_get_render_size, (APTR)beep_render,
+  (APTR)-1
+};
+
+static const APTR InitTable[] = {
+  (APTR)sizeof(BeepBase), (APTR)LibFuncs, NULL, (APTR)lib_init
+};
+
+// Exec scans the loaded segment for this, so it must not be static.
+const struct Resident RomTag = {
+  RTC_MATCHWORD, (struct Resident*)&RomTag, (APTR)(&RomTag + 1), RTF_AUTOINIT,
+  kBeepLibVersion, NT_LIBRARY, 0, kBeepLibName, kLibIdString, (APTR)InitTable
+};
@@ -0,0 +1,50 @@
+#ifndef BEEP_BEEPLIB_H
+#define BEEP_BEEPLIB_H
+
+// Public interface of beep.library, function offsets are in beep_lib.fd.
+//
+// Each client creates its own render context, so several tasks can render at
+// the same time. A context holds the parameters below, starting at the
+// defaults of beep's own UI. Render buffers are supplied by the client, in chip
+// memory if Paula is to play them.
+//
+//   context = BeepCreateContext()
+//   BeepSetParam(context, BeepParam_Cutoff, 2000)
+//   size = BeepGetRenderSize(context)            bytes per channel
+//   num_samples = BeepRender(context, samples, samples_right, &loop_start)
+//   BeepDeleteContext(context)
+
+#include <exec/types.h>
+
+#define kBeepLibName "beep.library"
+#define kBeepLibVersion 1
+
+typedef enum {
+  BeepParam_Osc1Wave,     // 0 square, 1 sawtooth, 2 triangle, 3 noise, 4 custom
+  BeepParam_Osc2Wave,
+  BeepParam_OscMix,       // 0-100, percent of oscillator 2
+  BeepParam_OscCouple,    // 0 mix, 1 sync, 2 ring
+  BeepParam_RateFreq,     // 1000-32767 Hz
+  BeepParam_Osc1Freq,     // 16.16 fixed-point Hz, 1-16383 Hz
+  BeepParam_Osc2Freq,
+  BeepParam_FineTune,     // 0-1, exact pitch instead of whole-sample periods
+  BeepParam_UnisonVoices, // 1-8, more than 1 replaces oscillator 2
+  BeepParam_UnisonSpread, // 0-100 cents
+  BeepParam_LengthMs,     // 100-4000
+  BeepParam_Cutoff,       // 100-4000 Hz
+  BeepParam_Shape,        // 0 off, 1 tanh, 2 fold, 3 crush
+  BeepParam_GainDb,       // 0-400, tenths of a dB
+  BeepParam_Normalize,    // 0-1
+  BeepParam_Dither,       // 0-1
+  BeepParam_Stereo,       // 0 off, 1 pan, 2 Haas
+  BeepParam_StereoWidth,  // 0-100
+  BeepParam_EnvAttack,    // 0-255, fraction of the length
+  BeepParam_EnvDecay,     // 0-255
+  BeepParam_EnvSustain,   // 0-255, level
+  BeepParam_EnvRelease,   // 1-255, attack + decay + release at most 255 to render
+  kNumBeepParams
+} BeepParam;
+
+#define kBeepCustomWavePoints 0x20 // BeepSetCustomWave() points, one cycle
+
+#endif
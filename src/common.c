@@ -1,12 +1,16 @@
 #include "common.h"
 #include "build/tables.h"
 
+#ifdef BEEP_HOST
+#include <stdio.h>
+#else
 #include <proto/dos.h>
 
 UWORD abs(WORD value) {
   WORD abs_mask = value >> (kBitsPerWord - 1);
   return (value ^ abs_mask) - abs_mask;
 }
+#endif
 
 UWORD str_len(STRPTR str) {
   UWORD len;
@@ -14,7 +18,30 @@ UWORD str_len(STRPTR str) {
   return len;
 }
 
+// C-8 to B-8 frequencies of equal-tempered scale, A-4 = 440Hz.
+UWORD Octave8Freqs[12] = {
+  4186, 4435, 4699, 4978, 5274, 5588, 5920, 6272, 6645, 7040, 7459, 7902
+};
+
+// Paula sampling periods for ProTracker notes.
+UWORD PTNotePeriods[PTOct_3 + 1][12] = {
+  { 856, 808, 762, 720, 678, 640, 604, 570, 538, 508, 480, 453 }, // C-1 to B-1
+  { 428, 404, 381, 360, 339, 320, 302, 285, 269, 254, 240, 226 }, // C-2 to B-2
+  { 214, 202, 190, 180, 170, 160, 151, 143, 135, 127, 120, 113 }, // C-3 to B-3
+};
+
+ULONG osc_freq_from_semis(UWORD total_semis) {
+  UWORD octave = total_semis / 12;
+  UWORD semitone = total_semis % 12;
+
+  // Scale C-8 to B-8 octave by 2^(octave-8), keeping the fraction.
+  return (ULONG)Octave8Freqs[semitone] << (kBitsPerWord + octave - 8);
+}
+
 VOID print_error(STRPTR msg) {
+#ifdef BEEP_HOST
+  fprintf(stderr, "beep: assert(%s) failed\n", msg);
+#else
   if (DOSBase) {
     STRPTR out_strs[] = { "beep: assert(", msg, ") failed\n" };
     BPTR out_handle = Output();
@@ -23,4 +50,53 @@ VOID print_error(STRPTR msg) {
       Write(out_handle, out_strs[i], str_len(out_strs[i]));
     }
   }
+#endif
+}
+
+// Steps of Fibonacci-delta compression, indexed by the 4-bit codes.
+BYTE FibDeltas[kFibDeltaCodes] = {
+  -34, -21, -13, -8, -5, -3, -2, -1, 0, 1, 2, 3, 5, 8, 13, 21
+};
+
+// Compress to a pad byte, the initial value and two 4-bit codes per byte, high
+// nibble first. Each code picks the step that lands nearest the sample from
+// the value the decoder will have, so errors don't accumulate, and steps that
+// would wrap the decoded byte are skipped.
+VOID fib_delta_encode(BYTE* samples,
+                      ULONG num_samples,
+                      UBYTE* out,
+                      UWORD* io_max_err,
+                      ULONG* io_sq_err) {
+  WORD value = samples[0];
+
+  out[0] = 0;
+  out[1] = value;
+  out += kFibDeltaHdrSize;
+
+  for (ULONG i = 0; i < num_samples; ++ i) {
+    UWORD best_code = 0;
+    UWORD best_err = kUWordMax;
+
+    for (UWORD code = 0; code < kFibDeltaCodes; ++ code) {
+      WORD next = value + FibDeltas[code];
+      UWORD err = ABS(samples[i] - next);
+
+      if (next >= -0x80 && next <= 0x7F && err < best_err) {
+        best_err = err;
+        best_code = code;
+      }
+    }
+
+    value += FibDeltas[best_code];
+
+    if (i & 1) {
+      out[i / 2] |= best_code;
+    }
+    else {
+      out[i / 2] = best_code << 4;
+    }
+
+    *io_max_err = MAX(*io_max_err, best_err);
+    *io_sq_err += best_err * best_err;
+  }
 }
@@ -1,7 +1,11 @@
 #ifndef BEEP_COMMON_H
 #define BEEP_COMMON_H
 
+#ifdef BEEP_HOST
+#include "host.h"
+#else
 #include <exec/types.h>
+#endif
 
 // Divide and round to nearest integer.
 #define DIV_ROUND_NEAREST(a, b) ((((a) >= 0) == ((b) >= 0) ? ((a) + ((b) / 2)) : ((a) - ((b) / 2))) / (b))
@@ -12,6 +16,7 @@
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define ABS(a) ((a) < 0 ? -(a) : (a))
 
 #define CHECK(x)     \
   if (! (x)) {       \
@@ -30,6 +35,36 @@
 #define kDbScaleRange 40 // 0-N dB
 #define kDbScaleSteps 5 // fractional steps per dB
 #define kDbScaleTableSize (kDbScaleRange * kDbScaleSteps + 1)
+#define kShaperTableSize 0x100
+#define kCentScaleRange 50 // -N to N cents
+#define kCentScaleTableSize (kCentScaleRange * 2 + 1)
+#define kWaveTableSize 0x100
+#define kWaveMipLevels 7
+#define kNoiseTableSize 0x800
+#define kLog2TableSize 0x100
+#define kLog2TableBits 8 // log2(kLog2TableSize)
+#define kCustomWavePoints 0x20
+#define kMaxUnisonVoices 8
+#define kMaxOscDetune 24 // semitones, kMaxOscDetune * kUnisonCentsPerDetune <= 2 * kCentScaleRange
+#define kUnisonCentsPerDetune 4 // unison spread per detune step
+#define kNumKeymapNotes 36 // C-1 to B-3
+#define kExportNameMaxLen 0x40
+#define kNumBankSlots 16
+#define kMinOctaveBase 1
+#define kMaxOctaveBase 5
+#define kMinCutoff 100 // Hz
+#define kMaxCutoff 4000
+#define kMinLengthMs 100
+#define kMaxLengthMs 4000
+#define kMaxSampleRateIdx 33 // A-3, shortest period Paula can fetch from chip memory
+#define kClockFreqPAL 3546895 // PAL crystal / 8
+#define kClockFreqNTSC 3579545 // NTSC crystal / 8
+#define kMinNumSamples 0x100 // shortest render per channel
+#define kSizeBudgetStep 0x80 // bytes per size budget knob step
+#define kMinSizeBudgetSteps ((2 * kMinNumSamples) / kSizeBudgetStep) // fits the shortest stereo render
+#define kMaxSizeBudgetSteps 0xFF
+#define kFibDeltaHdrSize 2 // pad byte, initial value
+#define kFibDeltaCodes 0x10
 #define kPenBG 0
 #define kPenDark 1
 #define kPenShadow 2
@@ -56,16 +91,55 @@ typedef struct {
 } Envelope;
 
 typedef enum {
-  Wave_Square, Wave_Sawtooth, Wave_Triangle, Wave_Noise, kNumWaves
+  Wave_Square, Wave_Sawtooth, Wave_Triangle, Wave_Noise, Wave_Custom, kNumWaves
 } Wave;
 
+typedef enum {
+  Couple_Mix, Couple_Sync, Couple_Ring, kNumCouples
+} Couple;
+
+typedef enum {
+  Stereo_Off, Stereo_Pan, Stereo_Haas, kNumStereoModes
+} Stereo;
+
+typedef enum {
+  Shape_Off, Shape_Tanh, Shape_Fold, Shape_Crush, kNumShapes
+} Shape;
+
+typedef enum {
+  Format_8SVX, Format_Raw, Format_Asm, Format_C, kNumFormats
+} Format;
+
+#ifndef BEEP_HOST
 extern UWORD abs(WORD value);
+#endif
 extern UWORD str_len(STRPTR str);
 extern VOID print_error(STRPTR msg);
 
+// Oscillator frequency in 16.16 fixed-point Hz, semitones counted from C-0.
+extern ULONG osc_freq_from_semis(UWORD total_semis);
+
+// Fibonacci-delta compresses num_samples (even) into kFibDeltaHdrSize +
+// num_samples / 2 bytes, adding its largest error to io_max_err and its
+// squared errors to io_sq_err.
+extern VOID fib_delta_encode(BYTE* samples,
+                             ULONG num_samples,
+                             UBYTE* out,
+                             UWORD* io_max_err,
+                             ULONG* io_sq_err);
+
+extern BYTE FibDeltas[kFibDeltaCodes];
+
 extern WORD SinTable[kSinTableSize];
 extern UWORD TanTable[kTanTableSize];
 extern UWORD DbScaleTable[kDbScaleTableSize];
+extern UWORD CentScaleTable[kCentScaleTableSize];
+extern WORD ShaperTable[kNumShapes - 1][kShaperTableSize];
+extern WORD WaveTable[Wave_Noise][kWaveMipLevels][kWaveTableSize];
+extern WORD NoiseTable[kNoiseTableSize];
+extern UWORD Log2Table[kLog2TableSize];
+extern UWORD Octave8Freqs[12];
+extern UWORD PTNotePeriods[PTOct_3 + 1][12];
 
 // kSinTableSize entries with range [0, (2*PI)-delta].
 static WORD sin_lookup(UWORD entry) {
@@ -88,4 +162,42 @@ static UWORD db_scale_lookup(UWORD entry) {
   return DbScaleTable[entry];
 }
 
+// Cents to frequency ratio lookup, range [0x0, 0xFFFF] = [0, 2].
+// kCentScaleTableSize entries with range [-kCentScaleRange, kCentScaleRange].
+static UWORD cent_scale_lookup(WORD cents) {
+  return CentScaleTable[cents + kCentScaleRange];
+}
+
+// Waveshaper transfer curve, NULL for Shape_Off.
+// Points at the center of kShaperTableSize entries with range [-1,1-delta].
+static WORD* shaper_lookup(Shape shape) {
+  return (shape == Shape_Off) ? NULL : &ShaperTable[shape - 1][kShaperTableSize / 2];
+}
+
+// Band-limited single cycle of Wave_Square, Wave_Sawtooth or Wave_Triangle.
+// Mip level N holds harmonics below kWaveTableSize >> (N + 1), for periods of
+// at least kWaveTableSize >> N samples.
+static WORD* wave_table_lookup(Wave wave,
+                               UWORD mip_level) {
+  return WaveTable[wave][mip_level];
+}
+
+// Base-2 logarithm of value > 0 as 16.16 fixed-point.
+// kLog2TableSize entries of the fraction with mantissa range [1, 2-delta].
+static ULONG log2_lookup(ULONG value) {
+  UWORD whole = kLog2TableBits;
+
+  while (value >= (2 * kLog2TableSize)) {
+    value >>= 1;
+    ++ whole;
+  }
+
+  while (value < kLog2TableSize) {
+    value <<= 1;
+    -- whole;
+  }
+
+  return ((ULONG)whole << kBitsPerWord) + Log2Table[value - kLog2TableSize];
+}
+
 #endif
@@ -1,40 +1,455 @@
 #include "exporter.h"
 
 #include <datatypes/soundclass.h>
+#include <dos/dostags.h>
 #include <proto/dos.h>
+#include <proto/exec.h>
+
+#ifndef ID_CHAN
+#define ID_CHAN MAKE_ID('C','H','A','N')
+#endif
+
+#define kChanStereo 6 // left (2) | right (4)
+#define kHistBins 0x100
+#define kNumStrMaxLen 12 // sign, decimal digits of a ULONG and terminator
+#define kLibVerKick2 36
+#define kPathMaxLen (kExportNameMaxLen + 6) // name, longest extension and terminator
+#define kTextBufSize 0x200
+#define kValuesPerLine 0x10
+#define kPatchExt ".beep"
+#define kGenExt ".gen"
+#define kGenDataExt ".gdat" // generator's parameter block, not a loadable patch
 
 extern struct DosLibrary* DOSBase;
 
 static struct {
-  UWORD dummy;
+  ULONG hists[2][kHistBins]; // sample values, sample deltas
+  UWORD fib_max_err;
+  ULONG fib_sq_err;
+  UBYTE* form;
+  ULONG form_size;
+  BYTE path[kPathMaxLen];
+  BYTE sym[kExportNameMaxLen + 2]; // label, room for the right channel's "_r"
+  UWORD sym_len;
+  BYTE text[kTextBufSize];
+  UWORD text_len;
+  struct Task* ui_task;
+  BYTE done_sig;
+  BOOL busy;
+  BOOL write_ok;
 } g;
 
-BOOL exporter_save(BYTE* samples,
-                   UWORD num_samples,
-                   UWORD rate_freq) {
+// Writes the decimal digits from the end of str, returns where they start.
+static STRPTR num_to_str(ULONG magnitude,
+                         BOOL negative,
+                         BYTE str[kNumStrMaxLen]) {
+  UWORD pos = kNumStrMaxLen - 1;
+
+  str[pos] = '\0';
+
+  do {
+    str[-- pos] = '0' + (magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+
+  if (negative) {
+    str[-- pos] = '-';
+  }
+
+  return str + pos;
+}
+
+static VOID print_str(STRPTR str) {
+  Write(Output(), str, str_len(str));
+}
+
+static VOID print_num(ULONG value) {
+  BYTE str[kNumStrMaxLen];
+  print_str(num_to_str(value, FALSE, str));
+}
+
+static ULONG sqrt_floor(ULONG value) {
+  ULONG root = 0;
+
+  for (ULONG bit = 1UL << 30; bit; bit >>= 2) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else {
+      root >>= 1;
+    }
+  }
+
+  return root;
+}
+
+// Writes the FORM assembled by exporter_save(), on the export process or the
+// UI task before Kickstart 2.0, then signals the UI task with the result.
+static VOID write_form() {
   BOOL ret = TRUE;
   BPTR file = NULL;
 
+  CHECK(file = Open(g.path, MODE_NEWFILE));
+  CHECK(Write(file, g.form, g.form_size) == g.form_size);
+
+cleanup:
+  if (file) {
+    Close(file);
+  }
+
+  // Stay in Forbid until the process exits so the UI can't unload its code first.
+  Forbid();
+  g.write_ok &= ret;
+  Signal(g.ui_task, 1UL << g.done_sig);
+}
+
+BOOL exporter_init() {
+  BOOL ret = TRUE;
+
+  g.ui_task = FindTask(NULL);
+  g.write_ok = TRUE;
+  CHECK((g.done_sig = AllocSignal(-1)) != -1);
+
+cleanup:
+  return ret;
+}
+
+static VOID wait_export() {
+  if (g.busy) {
+    Wait(1UL << g.done_sig);
+    g.busy = FALSE;
+  }
+}
+
+VOID exporter_fini() {
+  wait_export();
+
+  if (g.form) {
+    FreeMem(g.form, g.form_size);
+  }
+
+  if (g.ui_task && g.done_sig != -1) {
+    FreeSignal(g.done_sig);
+  }
+}
+
+ULONG exporter_done_signal() {
+  return 1UL << g.done_sig;
+}
+
+BOOL exporter_finish() {
+  BOOL write_ok = g.write_ok;
+
+  g.busy = FALSE;
+  g.write_ok = TRUE;
+
+  return write_ok;
+}
+
+// Stereo adds a CHAN chunk and stores the right channel after the left in BODY.
+// Samples from loop_start onward are the repeat part, played after the one-shot part.
+// Fibonacci-delta compression halves BODY and reports its error on the console.
+// The FORM is assembled in one buffer, so the samples can be rendered again
+// while a separate process writes it.
+static BOOL save_8svx(BYTE* samples,
+                      BYTE* samples_right,
+                      ULONG num_samples,
+                      ULONG loop_start,
+                      UWORD rate_freq,
+                      BOOL fib_delta) {
+  BOOL ret = TRUE;
+
   struct VoiceHeader vhdr = {
-    .vh_OneShotHiSamples = num_samples,
-    .vh_RepeatHiSamples = 0,
+    .vh_OneShotHiSamples = loop_start,
+    .vh_RepeatHiSamples = num_samples - loop_start,
     .vh_SamplesPerHiCycle = 0,
     .vh_SamplesPerSec = rate_freq,
     .vh_Octaves = 1,
-    .vh_Compression = CMP_NONE,
+    .vh_Compression = fib_delta ? CMP_FIBDELTA : CMP_NONE,
     .vh_Volume = Unity,
   };
 
+  ULONG chan_body_size = fib_delta ? (kFibDeltaHdrSize + (num_samples / 2)) : num_samples;
+  ULONG body_size = samples_right ? (2 * chan_body_size) : chan_body_size;
   ULONG vhdr_hdr[] = { ID_VHDR, sizeof(vhdr) };
-  ULONG body_hdr[] = { ID_BODY, num_samples };
-  ULONG form_hdr[] = { ID_FORM, sizeof(vhdr_hdr) + sizeof(vhdr) + sizeof(body_hdr) + num_samples };
+  ULONG chan_chunk[] = { ID_CHAN, sizeof(ULONG), kChanStereo };
+  ULONG chan_size = samples_right ? sizeof(chan_chunk) : 0;
+  ULONG body_hdr[] = { ID_BODY, body_size };
+  ULONG form_hdr[] = { ID_FORM, sizeof(ULONG) + sizeof(vhdr_hdr) + sizeof(vhdr) + chan_size + sizeof(body_hdr) + body_size + (body_size & 1), ID_8SVX };
 
-  CHECK(file = Open("beep.8svx", MODE_NEWFILE));
-  CHECK(Write(file, (VOID*)form_hdr, sizeof(form_hdr)) >= 0);
-  CHECK(Write(file, (VOID*)vhdr_hdr, sizeof(vhdr_hdr)) >= 0);
-  CHECK(Write(file, (VOID*)&vhdr, sizeof(vhdr)) >= 0);
-  CHECK(Write(file, (VOID*)body_hdr, sizeof(body_hdr)) >= 0);
-  CHECK(Write(file, (VOID*)samples, num_samples) >= 0);
+  if (g.form) {
+    FreeMem(g.form, g.form_size);
+  }
+
+  // FORM size counts the form type but not the ID and size longs in front of it.
+  g.form_size = (2 * sizeof(ULONG)) + form_hdr[1];
+  CHECK(g.form = (UBYTE*)AllocMem(g.form_size, MEMF_CLEAR));
+
+  UBYTE* form = g.form;
+  CopyMem(form_hdr, form, sizeof(form_hdr));
+  form += sizeof(form_hdr);
+  CopyMem(vhdr_hdr, form, sizeof(vhdr_hdr));
+  form += sizeof(vhdr_hdr);
+  CopyMem(&vhdr, form, sizeof(vhdr));
+  form += sizeof(vhdr);
+
+  if (samples_right) {
+    CopyMem(chan_chunk, form, sizeof(chan_chunk));
+    form += sizeof(chan_chunk);
+  }
+
+  CopyMem(body_hdr, form, sizeof(body_hdr));
+  form += sizeof(body_hdr);
+
+  if (fib_delta) {
+    g.fib_max_err = 0;
+    g.fib_sq_err = 0;
+    fib_delta_encode(samples, num_samples, form, &g.fib_max_err, &g.fib_sq_err);
+
+    if (samples_right) {
+      fib_delta_encode(samples_right, num_samples, form + chan_body_size, &g.fib_max_err, &g.fib_sq_err);
+    }
+
+    // RMS error in tenths, mean square scaled by 100 without overflowing.
+    ULONG total_samples = samples_right ? (2 * num_samples) : num_samples;
+    ULONG rms_tenths = sqrt_floor(((g.fib_sq_err / total_samples) * 100) +
+                                  (((g.fib_sq_err % total_samples) * 100) / total_samples));
+
+    print_str("fibdelta: max error ");
+    print_num(g.fib_max_err);
+    print_str(", rms error ");
+    print_num(rms_tenths / 10);
+    print_str(".");
+    print_num(rms_tenths % 10);
+    print_str("\n");
+  }
+  else {
+    CopyMem(samples, form, num_samples);
+
+    if (samples_right) {
+      CopyMem(samples_right, form + num_samples, num_samples);
+    }
+  }
+
+  // Buffer was cleared, so an odd BODY is already followed by its IFF pad byte.
+  g.busy = TRUE;
+
+  if (DOSBase->dl_lib.lib_Version < kLibVerKick2 ||
+      ! CreateNewProcTags(NP_Entry, (ULONG)write_form, NP_Name, (ULONG)"beep export",
+                          NP_Output, Output(), NP_CloseOutput, FALSE, TAG_DONE)) {
+    write_form();
+    Permit();
+  }
+
+cleanup:
+  return ret;
+}
+
+static BOOL flush_text(BPTR file) {
+  BOOL ret = (Write(file, g.text, g.text_len) == g.text_len);
+  g.text_len = 0;
+
+  return ret;
+}
+
+// Text is gathered in g.text and written a block at a time.
+static BOOL put_text(BPTR file,
+                     STRPTR str) {
+  BOOL ret = TRUE;
+  UWORD len = str_len(str);
+
+  if (g.text_len + len > kTextBufSize) {
+    CHECK(flush_text(file));
+  }
+
+  CopyMem(str, g.text + g.text_len, len);
+  g.text_len += len;
+
+cleanup:
+  return ret;
+}
+
+static BOOL put_num(BPTR file,
+                    LONG value) {
+  BYTE str[kNumStrMaxLen];
+  return put_text(file, num_to_str(ABS(value), value < 0, str));
+}
+
+// Signed 8-bit samples padded to a whole word, as Paula fetches them.
+static BOOL write_raw(BPTR file,
+                      BYTE* samples,
+                      ULONG num_samples) {
+  BOOL ret = TRUE;
+  BYTE pad = 0;
+
+  CHECK(Write(file, samples, num_samples) == num_samples);
+
+  if (num_samples & 1) {
+    CHECK(Write(file, &pad, 1) == 1);
+  }
+
+cleanup:
+  return ret;
+}
+
+// Length in words for AUDxLEN, then the word aligned label and samples.
+static BOOL write_asm(BPTR file,
+                      BYTE* samples,
+                      ULONG num_samples) {
+  BOOL ret = TRUE;
+  ULONG padded_len = (num_samples + 1) & ~1;
+
+  CHECK(put_text(file, g.sym));
+  CHECK(put_text(file, "_len\tequ\t"));
+  CHECK(put_num(file, padded_len / 2));
+  CHECK(put_text(file, "\n\teven\n"));
+  CHECK(put_text(file, g.sym));
+  CHECK(put_text(file, ":"));
+
+  for (ULONG i = 0; i < padded_len; ++ i) {
+    CHECK(put_text(file, (i % kValuesPerLine) ? "," : "\n\tdc.b\t"));
+    CHECK(put_num(file, (i < num_samples) ? samples[i] : 0));
+  }
+
+  CHECK(put_text(file, "\n"));
+
+cleanup:
+  return ret;
+}
+
+static BOOL write_c(BPTR file,
+                    BYTE* samples,
+                    ULONG num_samples) {
+  BOOL ret = TRUE;
+  ULONG padded_len = (num_samples + 1) & ~1;
+
+  CHECK(put_text(file, "signed char __chip "));
+  CHECK(put_text(file, g.sym));
+  CHECK(put_text(file, "["));
+  CHECK(put_num(file, padded_len));
+  CHECK(put_text(file, "] = {"));
+
+  for (ULONG i = 0; i < padded_len; ++ i) {
+    CHECK(put_text(file, (i == 0) ? "\n  " : (i % kValuesPerLine) ? ", " : ",\n  "));
+    CHECK(put_num(file, (i < num_samples) ? samples[i] : 0));
+  }
+
+  CHECK(put_text(file, "\n};\n"));
+
+cleanup:
+  return ret;
+}
+
+typedef struct {
+  STRPTR ext;
+  BOOL (*write_chan)(BPTR file, BYTE* samples, ULONG num_samples);
+} Writer;
+
+// 8SVX isn't streamed, save_8svx() assembles it for write_form().
+static Writer Writers[kNumFormats] = {
+  { ".8svx", NULL      },
+  { ".raw",  write_raw },
+  { ".i",    write_asm },
+  { ".c",    write_c   },
+};
+
+// Streams each channel from the sample buffers, the right one after the left.
+// This is quick enough to do on the UI task, which is signalled as for 8SVX.
+// It's marked busy the same way, so the next export consumes its signal
+// instead of letting it finish a later 8SVX export early.
+static VOID save_stream(Writer* writer,
+                        BYTE* samples,
+                        BYTE* samples_right,
+                        ULONG num_samples) {
+  BOOL ret = TRUE;
+  BPTR file = NULL;
+
+  g.text_len = 0;
+
+  CHECK(file = Open(g.path, MODE_NEWFILE));
+  CHECK(writer->write_chan(file, samples, num_samples));
+
+  if (samples_right) {
+    CopyMem("_r", g.sym + g.sym_len, 3);
+    CHECK(writer->write_chan(file, samples_right, num_samples));
+  }
+
+  CHECK(flush_text(file));
+
+cleanup:
+  if (file) {
+    Close(file);
+  }
+
+  g.write_ok &= ret;
+  g.busy = TRUE;
+  Signal(g.ui_task, 1UL << g.done_sig);
+}
+
+// Path is the name with the writer's extension. Text formats label the samples
+// with the name's file part, characters other than letters and digits
+// replaced by underscores.
+static VOID make_path(STRPTR name,
+                      STRPTR ext) {
+  UWORD name_len = MIN(str_len(name), kExportNameMaxLen - 1);
+  UWORD file_start = 0;
+
+  CopyMem(name, g.path, name_len);
+  CopyMem(ext, g.path + name_len, str_len(ext) + 1);
+
+  for (UWORD i = 0; i < name_len; ++ i) {
+    if (name[i] == '/' || name[i] == ':') {
+      file_start = i + 1;
+    }
+  }
+
+  g.sym_len = 0;
+
+  for (UWORD i = file_start; i < name_len; ++ i) {
+    BYTE c = name[i];
+    BOOL alnum = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+    g.sym[g.sym_len ++] = alnum ? c : '_';
+  }
+
+  g.sym[g.sym_len] = '\0';
+}
+
+BOOL exporter_save(Format format,
+                   STRPTR name,
+                   BYTE* samples,
+                   BYTE* samples_right,
+                   ULONG num_samples,
+                   ULONG loop_start,
+                   UWORD rate_freq,
+                   BOOL fib_delta) {
+  BOOL ret = TRUE;
+  Writer* writer = &Writers[format];
+
+  // One export at a time, the previous one's result is kept for exporter_finish().
+  wait_export();
+
+  make_path(name, writer->ext);
+
+  if (writer->write_chan) {
+    save_stream(writer, samples, samples_right, num_samples);
+  }
+  else {
+    CHECK(save_8svx(samples, samples_right, num_samples, loop_start, rate_freq, fib_delta));
+  }
+
+cleanup:
+  return ret;
+}
+
+static BOOL save_file(STRPTR path,
+                      APTR data,
+                      ULONG size) {
+  BOOL ret = TRUE;
+  BPTR file = NULL;
+
+  CHECK(file = Open(path, MODE_NEWFILE));
+  CHECK(Write(file, data, size) == size);
 
 cleanup:
   if (file) {
@@ -43,3 +458,121 @@ cleanup:
 
   return ret;
 }
+
+BOOL exporter_save_generator(STRPTR name,
+                             APTR gen,
+                             ULONG gen_size,
+                             APTR patch,
+                             ULONG patch_size,
+                             ULONG work_size,
+                             ULONG render_cycles) {
+  BOOL ret = TRUE;
+
+  // Path and label buffers may still be in use by the export process.
+  wait_export();
+
+  make_path(name, kGenExt);
+  CHECK(save_file(g.path, gen, gen_size));
+  print_str(g.path);
+  print_str(": ");
+  print_num(gen_size);
+
+  make_path(name, kGenDataExt);
+  CHECK(save_file(g.path, patch, patch_size));
+  print_str(" bytes\n");
+  print_str(g.path);
+  print_str(": ");
+  print_num(patch_size);
+
+  print_str(" bytes\nwork: ");
+  print_num(work_size);
+  print_str(" bytes\nrender: ");
+  print_num(render_cycles);
+  print_str(" cycles\n");
+
+cleanup:
+  return ret;
+}
+
+BOOL exporter_save_patch(STRPTR name,
+                         APTR patch,
+                         ULONG patch_size) {
+  // Path and label buffers may still be in use by the export process.
+  wait_export();
+  make_path(name, kPatchExt);
+
+  return save_file(g.path, patch, patch_size);
+}
+
+BOOL exporter_load_patch(STRPTR name,
+                         APTR patch,
+                         ULONG patch_size,
+                         ULONG* out_read_size) {
+  BOOL ret = TRUE;
+  BPTR file = NULL;
+  LONG read_size;
+
+  wait_export();
+  make_path(name, kPatchExt);
+
+  CHECK(file = Open(g.path, MODE_OLDFILE));
+  CHECK((read_size = Read(file, patch, patch_size)) >= 0);
+
+  *out_read_size = read_size;
+
+cleanup:
+  if (file) {
+    Close(file);
+  }
+
+  return ret;
+}
+
+// Order-0 entropy of the sample values or of their deltas, whichever is lower.
+// Crunchers model audio about this well, so it tracks the packed size closely
+// enough to judge sounds by. Costs one pass over the samples and a logarithm
+// per histogram bin.
+ULONG exporter_estimate_size(BYTE* samples,
+                             BYTE* samples_right,
+                             ULONG num_samples) {
+  BYTE* chan_samples[2] = { samples, samples_right };
+  ULONG num_bytes = 0;
+
+  for (UWORD bin = 0; bin < kHistBins; ++ bin) {
+    g.hists[0][bin] = 0;
+    g.hists[1][bin] = 0;
+  }
+
+  for (UWORD ch = 0; ch < 2 && chan_samples[ch]; ++ ch) {
+    BYTE* chan = chan_samples[ch];
+    BYTE prev = 0;
+
+    for (ULONG i = 0; i < num_samples; ++ i) {
+      ++ g.hists[0][(UBYTE)chan[i]];
+      ++ g.hists[1][(UBYTE)(chan[i] - prev)];
+      prev = chan[i];
+    }
+
+    num_bytes += num_samples;
+  }
+
+  // bits = sum(count * log2(num_bytes / count)), in 24.8 fixed-point.
+  ULONG num_bytes_log2 = log2_lookup(num_bytes) >> kBitsPerByte;
+  ULONG min_bits = 0xFFFFFFFF;
+
+  for (UWORD hist = 0; hist < 2; ++ hist) {
+    ULONG bits = 0;
+
+    for (UWORD bin = 0; bin < kHistBins; ++ bin) {
+      ULONG count = g.hists[hist][bin];
+
+      if (count) {
+        bits += count * (num_bytes_log2 - (log2_lookup(count) >> kBitsPerByte));
+      }
+    }
+
+    min_bits = MIN(min_bits, bits);
+  }
+
+  return min_bits >> (kBitsPerByte + 3);
+}
@@ -3,8 +3,49 @@
 
 #include "common.h"
 
-BOOL exporter_save(BYTE* samples,
-                   UWORD num_samples,
-                   UWORD rate_freq);
+BOOL exporter_init();
+VOID exporter_fini();
+
+// Export runs on a separate process, exporter_done_signal() is set when it
+// completes and exporter_finish() then returns whether it succeeded.
+ULONG exporter_done_signal();
+BOOL exporter_finish();
+
+// Writes name with the format's extension. Only 8SVX keeps the rate and loop.
+BOOL exporter_save(Format format,
+                   STRPTR name,
+                   BYTE* samples,
+                   BYTE* samples_right,
+                   ULONG num_samples,
+                   ULONG loop_start,
+                   UWORD rate_freq,
+                   BOOL fib_delta);
+
+// Writes the generator and patch made by synth_make_generator(), name with
+// .gen and .gdat extensions, and reports their sizes, the work area they need
+// and the render time on the console.
+BOOL exporter_save_generator(STRPTR name,
+                             APTR gen,
+                             ULONG gen_size,
+                             APTR patch,
+                             ULONG patch_size,
+                             ULONG work_size,
+                             ULONG render_cycles);
+
+// Writes a patch file of the given size, name with a .beep extension.
+BOOL exporter_save_patch(STRPTR name,
+                         APTR patch,
+                         ULONG patch_size);
+
+// Reads up to patch_size bytes of a patch file in one go.
+BOOL exporter_load_patch(STRPTR name,
+                         APTR patch,
+                         ULONG patch_size,
+                         ULONG* out_read_size);
+
+// Estimated size in bytes once packed by a cruncher.
+ULONG exporter_estimate_size(BYTE* samples,
+                             BYTE* samples_right,
+                             ULONG num_samples);
 
 #endif
@@ -6,6 +6,47 @@
 #define kDbScaleRange 40 // 0-N dB
 #define kDbScaleSteps 5 // N fractional steps per dB
 #define kDbScaleTableSize (kDbScaleRange * kDbScaleSteps + 1)
+#define kShaperTableSize 0x100
+#define kCentScaleRange 50 // -N to N cents
+#define kCentScaleTableSize (kCentScaleRange * 2 + 1)
+#define kShaperTanhDrive 4.0
+#define kShaperFoldDrive 2.5
+#define kShaperCrushLevels 8
+#define kWaveTableSize 0x100
+#define kWaveMipLevels 7
+#define kNoiseTableSize 0x800
+#define kLog2TableSize 0x100
+
+// Transfer curves for Shape_Tanh, Shape_Fold, Shape_Crush, range [-1,1] to [-1,1].
+static double shape_tanh(double x) {
+  return tanh(x * kShaperTanhDrive) / tanh(kShaperTanhDrive);
+}
+
+static double shape_fold(double x) {
+  return sin(x * kShaperFoldDrive * M_PI / 2.0);
+}
+
+static double shape_crush(double x) {
+  return round(x * (kShaperCrushLevels / 2)) / (kShaperCrushLevels / 2);
+}
+
+static double (*ShapeFuncs[])(double) = { shape_tanh, shape_fold, shape_crush };
+
+// Fourier series harmonic amplitudes for Wave_Square, Wave_Sawtooth, Wave_Triangle,
+// matching the phase of the naive waveforms (rising from zero at phase 0).
+static double harmonic_square(int k) {
+  return (k & 1) ? 4.0 / (M_PI * k) : 0.0;
+}
+
+static double harmonic_sawtooth(int k) {
+  return ((k & 1) ? 2.0 : -2.0) / (M_PI * k);
+}
+
+static double harmonic_triangle(int k) {
+  return (k & 1) ? (((k & 3) == 1) ? 8.0 : -8.0) / (M_PI * M_PI * k * k) : 0.0;
+}
+
+static double (*HarmonicFuncs[])(int) = { harmonic_square, harmonic_sawtooth, harmonic_triangle };
 
 int main() {
   printf("WORD SinTable[kSinTableSize] = {");
@@ -51,5 +92,125 @@ int main() {
     printf(" 0x%04hX,", scale_fix);
   }
 
+  printf("\n};\n\n");
+  printf("UWORD CentScaleTable[kCentScaleTableSize] = {");
+
+  for (int i = 0; i < kCentScaleTableSize; ++ i) {
+    double cents = i - kCentScaleRange;
+    double scale = pow(2.0, cents / 1200.0);
+    unsigned short scale_fix = (unsigned short)round(scale * 32768.0);
+
+    if ((i & 7) == 0) {
+      printf("\n ");
+    }
+
+    printf(" 0x%04hX,", scale_fix);
+  }
+
+  printf("\n};\n\n");
+  printf("WORD ShaperTable[kNumShapes - 1][kShaperTableSize] = {");
+
+  for (int shape = 0; shape < sizeof(ShapeFuncs) / sizeof(ShapeFuncs[0]); ++ shape) {
+    printf("\n  {");
+
+    for (int i = 0; i < kShaperTableSize; ++ i) {
+      // Entries ordered by signed upper byte of input sample, [-0x80,0x7F].
+      double x = (double)(i - (kShaperTableSize / 2)) / (double)(kShaperTableSize / 2);
+      double y = fmax(-1.0, fmin(1.0, ShapeFuncs[shape](x)));
+      short y_fix = (short)round(y * 32767.0);
+
+      if ((i & 7) == 0) {
+        printf("\n   ");
+      }
+
+      printf(" 0x%04hX,", y_fix);
+    }
+
+    printf("\n  },");
+  }
+
+  printf("\n};\n\n");
+  printf("WORD WaveTable[Wave_Noise][kWaveMipLevels][kWaveTableSize] = {");
+
+  for (int wave = 0; wave < sizeof(HarmonicFuncs) / sizeof(HarmonicFuncs[0]); ++ wave) {
+    printf("\n  {");
+
+    for (int level = 0; level < kWaveMipLevels; ++ level) {
+      // Level N is played at periods of at least (kWaveTableSize >> N) samples,
+      // keep harmonics below half that so none reach the Nyquist frequency.
+      int num_harmonics = fmax(1, (kWaveTableSize >> (level + 1)) - 1);
+      double table[kWaveTableSize];
+      double peak = 0.0;
+
+      for (int i = 0; i < kWaveTableSize; ++ i) {
+        double ang = (double)i / (double)kWaveTableSize * 2.0 * M_PI;
+        table[i] = 0.0;
+
+        for (int k = 1; k <= num_harmonics; ++ k) {
+          table[i] += HarmonicFuncs[wave](k) * sin(ang * k);
+        }
+
+        peak = fmax(peak, fabs(table[i]));
+      }
+
+      printf("\n    {");
+
+      for (int i = 0; i < kWaveTableSize; ++ i) {
+        // Normalize each level to full scale, Gibbs ripple would otherwise overflow.
+        short y_fix = (short)round(table[i] / peak * 32767.0);
+
+        if ((i & 7) == 0) {
+          printf("\n     ");
+        }
+
+        printf(" 0x%04hX,", y_fix);
+      }
+
+      printf("\n    },");
+    }
+
+    printf("\n  },");
+  }
+
+  printf("\n};\n\n");
+  printf("WORD NoiseTable[kNoiseTableSize] = {");
+
+  // LFSR PRNG (http://codebase64.org/doku.php?id=base:small_fast_16-bit_prng)
+  unsigned short seed = 0;
+
+  for (int i = 0; i < kNoiseTableSize; ++ i) {
+    if (seed == 0) {
+      seed = 0xC2DF;
+    }
+    else {
+      int carry = seed & 0x8000;
+      seed <<= 1;
+
+      if (seed != 0 && carry) {
+        seed ^= 0xC2DF;
+      }
+    }
+
+    if ((i & 7) == 0) {
+      printf("\n ");
+    }
+
+    printf(" 0x%04hX,", seed);
+  }
+
+  printf("\n};\n\n");
+  printf("UWORD Log2Table[kLog2TableSize] = {");
+
+  for (int i = 0; i < kLog2TableSize; ++ i) {
+    double frac = log2(1.0 + ((double)i / (double)kLog2TableSize));
+    unsigned short frac_fix = (unsigned short)round(frac * 65535.0);
+
+    if ((i & 7) == 0) {
+      printf("\n ");
+    }
+
+    printf(" 0x%04hX,", frac_fix);
+  }
+
   printf("\n};\n");
 }
@@ -0,0 +1,30 @@
+#ifndef BEEP_HOST_H
+#define BEEP_HOST_H
+
+// Amiga types and Exec memory calls for building the synth on a 32/64-bit host.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VOID void
+#define TRUE 1
+#define FALSE 0
+#define MEMF_CHIP 0
+#define MEMF_CLEAR 0x10000
+
+typedef int8_t BYTE;
+typedef uint8_t UBYTE;
+typedef int16_t WORD;
+typedef uint16_t UWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef int16_t BOOL;
+typedef void* APTR;
+typedef char* STRPTR;
+
+#define AllocMem(size, flags) (((flags) & MEMF_CLEAR) ? calloc(1, (size)) : malloc(size))
+#define FreeMem(ptr, size) free(ptr)
+#define CopyMem(src, dst, size) memmove((dst), (src), (size))
+
+#endif
@@ -1,4 +1,5 @@
 #include "common.h"
+#include "exporter.h"
 #include "model.h"
 #include "player.h"
 #include "synth.h"
@@ -7,40 +8,169 @@
 
 #include <dos/dos.h>
 #include <dos/dosextens.h>
+#include <dos/rdargs.h>
 #include <exec/execbase.h>
 #include <graphics/gfxbase.h>
 #include <intuition/intuitionbase.h>
+#include <proto/dos.h>
 #include <proto/exec.h>
 
 #define kOSLibVer 33 // Kickstart 1.2
+#define kReadArgsLibVer 36 // Kickstart 2.0
+#define kArgsTemplate "NAME,PATCH/K,FORMAT/K,RATE/K/N,OCTAVE/K/N,LENGTH/K/N,CUTOFF/K/N,GAIN/K/N,FIB/S,KEYMAP/S,UI/S"
+
+typedef enum {
+  Arg_Name, Arg_Patch, Arg_Format, Arg_Rate, Arg_Octave, Arg_Length, Arg_Cutoff, Arg_Gain,
+  Arg_Fib, Arg_Keymap, Arg_UI, kNumArgs
+} Arg;
 
 struct DosLibrary* DOSBase;
 struct IntuitionBase* IntuitionBase;
 struct GfxBase* GfxBase;
 struct ExecBase* SysBase;
 
-int main() {
+static STRPTR FormatNames[kNumFormats] = {
+  "8SVX", "RAW", "ASM", "C"
+};
+
+static BOOL str_equal_nocase(STRPTR a,
+                             STRPTR b) {
+  for (; *a && *b; ++ a, ++ b) {
+    if ((*a & ~0x20) != (*b & ~0x20)) {
+      return FALSE;
+    }
+  }
+
+  return (*a == *b);
+}
+
+// Numbers are in the units of the model: RATE counts notes from C-1, GAIN is
+// in tenths of a dB. Parameters not given keep their defaults, or the values
+// of the PATCH loaded first.
+static BOOL apply_args(LONG* args) {
+  BOOL ret = TRUE;
+
+  if (args[Arg_Name]) {
+    model_set_export_name((STRPTR)args[Arg_Name]);
+  }
+
+  if (args[Arg_Patch]) {
+    CHECK(model_load_patch((STRPTR)args[Arg_Patch]));
+  }
+
+  if (args[Arg_Format]) {
+    Format format = 0;
+
+    while (format < kNumFormats && ! str_equal_nocase((STRPTR)args[Arg_Format], FormatNames[format])) {
+      ++ format;
+    }
+
+    CHECK(format < kNumFormats);
+    model_set_export_format(format);
+  }
+
+  if (args[Arg_Rate]) {
+    LONG rate_idx = *(LONG*)args[Arg_Rate];
+    CHECK(rate_idx >= 0 && rate_idx <= kMaxSampleRateIdx);
+
+    PTNote rate = {
+      .semitone = rate_idx % 12,
+      .pt_octave = rate_idx / 12,
+    };
+
+    model_set_sample_rate(&rate);
+  }
+
+  if (args[Arg_Octave]) {
+    LONG octave_base = *(LONG*)args[Arg_Octave];
+    CHECK(octave_base >= kMinOctaveBase && octave_base <= kMaxOctaveBase);
+    model_set_octave_base(octave_base);
+  }
+
+  if (args[Arg_Length]) {
+    LONG length_ms = *(LONG*)args[Arg_Length];
+    CHECK(length_ms >= kMinLengthMs && length_ms <= kMaxLengthMs);
+    model_set_length_ms(length_ms);
+  }
+
+  if (args[Arg_Cutoff]) {
+    LONG cutoff = *(LONG*)args[Arg_Cutoff];
+    CHECK(cutoff >= kMinCutoff && cutoff <= kMaxCutoff);
+    model_set_cutoff(cutoff);
+  }
+
+  if (args[Arg_Gain]) {
+    LONG gain_db = *(LONG*)args[Arg_Gain];
+    CHECK(gain_db >= 0 && gain_db <= kDbScaleRange * 10);
+    model_set_gain_db(gain_db);
+  }
+
+  if (args[Arg_Fib]) {
+    model_set_fib_delta(TRUE);
+  }
+
+cleanup:
+  return ret;
+}
+
+// With arguments the sample, or keymap with KEYMAP, is rendered and exported
+// without opening the screen or audio, unless UI is given. Arguments need
+// ReadArgs() from Kickstart 2.0, before that the UI always opens.
+int main(int argc,
+         char** argv) {
   BOOL ret = TRUE;
+  struct RDArgs* rd_args = NULL;
+  LONG args[kNumArgs] = { 0 };
+  BOOL headless = FALSE;
 
   CHECK(DOSBase = (struct DosLibrary*)OpenLibrary("dos.library", kOSLibVer));
   CHECK(IntuitionBase = (struct IntuitionBase*)OpenLibrary("intuition.library", kOSLibVer));
   CHECK(GfxBase = (struct GfxBase*)OpenLibrary("graphics.library", kOSLibVer));
   CHECK(SysBase = (struct ExecBase*)OpenLibrary("exec.library", kOSLibVer));
 
+  if (argc > 1 && DOSBase->dl_lib.lib_Version >= kReadArgsLibVer) {
+    if (! (rd_args = ReadArgs(kArgsTemplate, args, NULL))) {
+      PrintFault(IoErr(), "beep");
+    }
+
+    CHECK(rd_args);
+    headless = ! args[Arg_UI];
+  }
+
   CHECK(synth_init());
-  CHECK(player_init());
+  CHECK(exporter_init());
+
+  if (! headless) {
+    CHECK(player_init());
+  }
+
   CHECK(model_init());
-  CHECK(widgets_init());
-  CHECK(ui_init());
+  CHECK(apply_args(args));
 
-  CHECK(ui_handle_events());
+  if (headless) {
+    CHECK(args[Arg_Keymap] ? model_export_keymap() : model_export_sample());
+
+    // Last file may still be written by the export process.
+    Wait(model_export_signal());
+    CHECK(model_export_finish());
+  }
+  else {
+    CHECK(widgets_init());
+    CHECK(ui_init());
+
+    CHECK(ui_handle_events());
+  }
 
 cleanup:
   ui_fini();
   widgets_fini();
   model_fini();
   player_fini();
-  synth_fini();
+  exporter_fini();
+
+  if (rd_args) {
+    FreeArgs(rd_args);
+  }
 
   CloseLibrary((struct Library*)SysBase);
   CloseLibrary((struct Library*)GfxBase);
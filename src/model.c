@@ -4,84 +4,201 @@
 #include "synth.h"
 
 #include <graphics/gfxbase.h>
+#include <libraries/iffparse.h>
+#include <proto/exec.h>
 
 #include <proto/dos.h> // FIXME
 
 #define kLibVerKick3 39
-#define kClockFreqPAL 3546895 // PAL crystal / 8
-#define kClockFreqNTSC 3579545 // NTSC crystal / 8
 #define kDefOsc1Wave Wave_Square
 #define kDefOsc2Wave Wave_Sawtooth
 #define kDefOscMix 50
 #define kDefOscDetune 12
+#define kDefOscCouple Couple_Mix
+#define kDefUnisonVoices 1
+#define kDefFineTune FALSE
 #define kDefSampleRateSemitone Semi_C
 #define kDefSampleRateOctave PTOct_3
 #define kDefOctaveBase 3
 #define kDefLengthMs 750
 #define kDefCutoff 1100
+#define kDefShape Shape_Off
+#define kDefNormalize FALSE
+#define kDefDither FALSE
+#define kDefStereo Stereo_Off
+#define kDefStereoWidth 50
+#define kDefSizeBudget 0
+#define kDefFibDelta FALSE
+#define kDefKeymapLow 0 // C-1
+#define kDefKeymapHigh (kNumKeymapNotes - 1) // B-3
+#define kDefExportFormat Format_8SVX
+#define kDefExportName "beep"
+#define kDefCacheBudget 0x20000 // bytes of chip memory
 #define kDefGainDb 0
 #define kDefAmpEnvAttack (kUByteMax / 5)
 #define kDefAmpEnvDecay (kUByteMax / 10)
 #define kDefAmpEnvSustain ((kUByteMax / 2) + 5)
 #define kDefAmpEnvRelease (kUByteMax / 5)
+#define kNumberSuffixLen 3 // "_NN"
+#define kPatchVersion 1
+#define kNumCacheEntries 0x40
+#define kFNVOffset 0x811C9DC5
+#define kFNVPrime 0x01000193
+#define ID_BEEP MAKE_ID('B','E','E','P')
+#define ID_PARM MAKE_ID('P','A','R','M')
+#define kHistorySize 0x200 // deltas, power of 2
+#define kDeltaStepEnd 0x80 // set in the param of a step's last delta
+
+// Rendered sample of a patch, in chip memory so it plays without a copy.
+typedef struct {
+  Patch patch;
+  ULONG hash;
+  ULONG last_used; // g.cache_clock when last used, 0 if the entry is free
+  BYTE* samples;   // right channel follows the left, word aligned
+  ULONG size;
+  BOOL stereo;
+  ULONG num_samples;
+  ULONG loop_start;
+  ULONG packed_size;
+} CacheEntry;
+
+// Change of one byte of the Patch, param being its offset. Words change as two
+// deltas of the same step, which are always applied together.
+typedef struct {
+  UBYTE param;
+  UBYTE old_value;
+  UBYTE new_value;
+} Delta;
+
+// FORM BEEP holding a single PARM chunk.
+typedef struct {
+  ULONG form_hdr[3];
+  ULONG parm_hdr[2];
+  Patch patch;
+} PatchFile;
 
 extern struct GfxBase* GfxBase;
 
 static struct {
+  Synth* synth;
   ULONG clock_freq;
   Wave osc1_wave;
   Wave osc2_wave;
+  BYTE custom_wave[kCustomWavePoints];
   UWORD osc_mix;
   UWORD osc_detune;
+  Couple osc_couple;
+  UWORD unison_voices;
+  BOOL fine_tune;
   PTNote sample_rate;
   UWORD octave_base;
   UWORD length_ms;
   UWORD cutoff;
+  Shape shape;
   WORD gain_db;
+  BOOL normalize;
+  BOOL dither;
+  Stereo stereo;
+  UWORD stereo_width;
+  UWORD size_budget;
+  BOOL fib_delta;
+  UWORD keymap_low;
+  UWORD keymap_high;
+  Format export_format;
+  STRPTR export_name;
   Envelope amp_env;
   BOOL samples_dirty;
   BYTE* samples;
-  UWORD num_samples;
+  BYTE* samples_right;
+  ULONG num_samples;
+  ULONG loop_start;
+  ULONG packed_size;
+  Patch bank[kNumBankSlots];
+  UWORD recalled_slots[2]; // previous and last
+  CacheEntry cache[kNumCacheEntries];
+  ULONG cache_clock;
+  ULONG cache_size;
+  ULONG cache_budget;
+  Delta history[kHistorySize];
+  ULONG history_begin; // oldest delta, counters index history modulo its size
+  ULONG history_pos;   // first delta that can be redone
+  ULONG history_end;
+  Patch history_patch; // as it was at model_history_begin()
 } g;
 
-// C-8 to B-8 frequencies of equal-tempered scale, A-4 = 440Hz.
-static UWORD Octave8Freqs[] = {
-  4186, 4435, 4699, 4978, 5274, 5588, 5920, 6272, 6645, 7040, 7459, 7902
-};
+BOOL model_init() {
+  BOOL ret = TRUE;
 
-// Paula sampling periods for ProTracker notes.
-static UWORD PTNotePeriods[3][12] = {
-  { 856, 808, 762, 720, 678, 640, 604, 570, 538, 508, 480, 453 }, // C-1 to B-1
-  { 428, 404, 381, 360, 339, 320, 302, 285, 269, 254, 240, 226 }, // C-2 to B-2
-  { 214, 202, 190, 180, 170, 160, 151, 143, 135, 127, 120, 113 }, // C-3 to B-3
-};
+  CHECK(g.synth = synth_create());
 
-BOOL model_init() {
   g.osc1_wave = kDefOsc1Wave;
   g.osc2_wave = kDefOsc2Wave;
   g.osc_mix = kDefOscMix;
   g.osc_detune = kDefOscDetune;
+  g.osc_couple = kDefOscCouple;
+  g.unison_voices = kDefUnisonVoices;
+  g.fine_tune = kDefFineTune;
   g.sample_rate.semitone = kDefSampleRateSemitone;
   g.sample_rate.pt_octave = kDefSampleRateOctave;
   g.octave_base = kDefOctaveBase;
   g.length_ms = kDefLengthMs;
   g.cutoff = kDefCutoff;
+  g.shape = kDefShape;
   g.gain_db = kDefGainDb;
+  g.normalize = kDefNormalize;
+  g.dither = kDefDither;
+  g.stereo = kDefStereo;
+  g.stereo_width = kDefStereoWidth;
+  g.size_budget = kDefSizeBudget;
+  g.fib_delta = kDefFibDelta;
+  g.keymap_low = kDefKeymapLow;
+  g.keymap_high = kDefKeymapHigh;
+  g.export_format = kDefExportFormat;
+  g.export_name = kDefExportName;
   g.amp_env.attack = kDefAmpEnvAttack;
   g.amp_env.decay = kDefAmpEnvDecay;
   g.amp_env.sustain = kDefAmpEnvSustain;
   g.amp_env.release = kDefAmpEnvRelease;
   g.samples_dirty = TRUE;
+  g.cache_budget = kDefCacheBudget;
+
+  // Custom wave starts out as one cycle of a sine.
+  for (UWORD i = 0; i < kCustomWavePoints; ++ i) {
+    g.custom_wave[i] = sin_lookup((i * kSinTableSize) / kCustomWavePoints) >> kBitsPerByte;
+  }
 
   // >= Kickstart 3.0: Clock detection is accurate.
   //  < Kickstart 3.0: Clock is guessed from PAL/NTSC boot setting.
   UWORD pal_mask = (GfxBase->LibNode.lib_Version >= kLibVerKick3) ? REALLY_PAL : PAL;
   g.clock_freq = (GfxBase->DisplayFlags & pal_mask) ? kClockFreqPAL : kClockFreqNTSC;
 
-  return TRUE;
+  for (UWORD slot = 0; slot < kNumBankSlots; ++ slot) {
+    model_get_patch(&g.bank[slot]);
+  }
+
+cleanup:
+  return ret;
+}
+
+static VOID free_cache_entry(CacheEntry* entry) {
+  FreeMem(entry->samples, entry->size);
+  g.cache_size -= entry->size;
+  entry->last_used = 0;
 }
 
 VOID model_fini() {
+  player_stop();
+
+  for (UWORD i = 0; i < kNumCacheEntries; ++ i) {
+    if (g.cache[i].last_used) {
+      free_cache_entry(&g.cache[i]);
+    }
+  }
+
+  if (g.synth) {
+    synth_delete(g.synth);
+    g.synth = NULL;
+  }
 }
 
 Wave model_get_osc1_wave() {
@@ -102,6 +219,15 @@ VOID model_set_osc2_wave(Wave wave) {
   g.samples_dirty = TRUE;
 }
 
+BYTE* model_get_custom_wave() {
+  return g.custom_wave;
+}
+
+VOID model_set_custom_wave(BYTE* custom_wave) {
+  CopyMem(custom_wave, g.custom_wave, sizeof(g.custom_wave));
+  g.samples_dirty = TRUE;
+}
+
 PTNote* model_get_sample_rate() {
   return &g.sample_rate;
 }
@@ -138,6 +264,15 @@ VOID model_set_cutoff(UWORD cutoff) {
   g.samples_dirty = TRUE;
 }
 
+Shape model_get_shape() {
+  return g.shape;
+}
+
+VOID model_set_shape(Shape shape) {
+  g.shape = shape;
+  g.samples_dirty = TRUE;
+}
+
 UWORD model_get_gain_db() {
   return g.gain_db;
 }
@@ -174,6 +309,124 @@ void model_set_osc_detune(UWORD osc_detune) {
   g.samples_dirty = TRUE;
 }
 
+Couple model_get_osc_couple() {
+  return g.osc_couple;
+}
+
+VOID model_set_osc_couple(Couple osc_couple) {
+  g.osc_couple = osc_couple;
+  g.samples_dirty = TRUE;
+}
+
+UWORD model_get_unison_voices() {
+  return g.unison_voices;
+}
+
+VOID model_set_unison_voices(UWORD unison_voices) {
+  g.unison_voices = unison_voices;
+  g.samples_dirty = TRUE;
+}
+
+BOOL model_get_fine_tune() {
+  return g.fine_tune;
+}
+
+VOID model_set_fine_tune(BOOL fine_tune) {
+  g.fine_tune = fine_tune;
+  g.samples_dirty = TRUE;
+}
+
+BOOL model_get_normalize() {
+  return g.normalize;
+}
+
+VOID model_set_normalize(BOOL normalize) {
+  g.normalize = normalize;
+  g.samples_dirty = TRUE;
+}
+
+BOOL model_get_dither() {
+  return g.dither;
+}
+
+VOID model_set_dither(BOOL dither) {
+  g.dither = dither;
+  g.samples_dirty = TRUE;
+}
+
+Stereo model_get_stereo() {
+  return g.stereo;
+}
+
+VOID model_set_stereo(Stereo stereo) {
+  g.stereo = stereo;
+  g.samples_dirty = TRUE;
+}
+
+UWORD model_get_stereo_width() {
+  return g.stereo_width;
+}
+
+VOID model_set_stereo_width(UWORD stereo_width) {
+  g.stereo_width = stereo_width;
+  g.samples_dirty = TRUE;
+}
+
+UWORD model_get_size_budget() {
+  return g.size_budget;
+}
+
+VOID model_set_size_budget(UWORD size_budget) {
+  g.size_budget = size_budget;
+  g.samples_dirty = TRUE;
+}
+
+// Fibonacci-delta compression only affects export, the sample isn't re-rendered.
+BOOL model_get_fib_delta() {
+  return g.fib_delta;
+}
+
+VOID model_set_fib_delta(BOOL fib_delta) {
+  g.fib_delta = fib_delta;
+}
+
+UWORD model_get_keymap_low() {
+  return g.keymap_low;
+}
+
+VOID model_set_keymap_low(UWORD keymap_low) {
+  g.keymap_low = keymap_low;
+}
+
+UWORD model_get_keymap_high() {
+  return g.keymap_high;
+}
+
+VOID model_set_keymap_high(UWORD keymap_high) {
+  g.keymap_high = keymap_high;
+}
+
+Format model_get_export_format() {
+  return g.export_format;
+}
+
+VOID model_set_export_format(Format export_format) {
+  g.export_format = export_format;
+}
+
+STRPTR model_get_export_name() {
+  return g.export_name;
+}
+
+VOID model_set_export_name(STRPTR export_name) {
+  g.export_name = export_name;
+}
+
+// Estimated packed size of the last rendered sample, 0 before the first render.
+ULONG model_get_packed_size() {
+  return g.packed_size;
+}
+
 static UWORD period_from_note(PTNote* note) {
   return PTNotePeriods[note->pt_octave][note->semitone];
 }
@@ -182,28 +435,225 @@ static UWORD freq_from_note(PTNote* note) {
   return DIV_ROUND_NEAREST(g.clock_freq, period_from_note(note));
 }
 
+// Sample rate and length that are rendered. With a size budget the length is
+// kept and the highest rate whose sample fits is chosen. If the lowest rate
+// doesn't fit either, the length is shortened instead. The envelope scales
+// with the length, so its shape is kept. Budgets start where the shortest
+// render fits, so the shortened sample is within the budget.
+VOID model_get_render_size(PTNote* out_rate,
+                           UWORD* out_length_ms) {
+  *out_rate = g.sample_rate;
+  *out_length_ms = g.length_ms;
+
+  if (! g.size_budget) {
+    return;
+  }
+
+  ULONG chan_budget = (g.stereo == Stereo_Off) ? g.size_budget : (g.size_budget / 2);
+
+  for (WORD rate_idx = kMaxSampleRateIdx; rate_idx >= 0; -- rate_idx) {
+    out_rate->semitone = rate_idx % 12;
+    out_rate->pt_octave = rate_idx / 12;
+
+    if (synth_num_samples(freq_from_note(out_rate), g.length_ms) <= chan_budget) {
+      return;
+    }
+  }
+
+  *out_length_ms = MIN(g.length_ms, (chan_budget * 1000) / freq_from_note(out_rate));
+}
+
+// FNV-1a over the patch bytes.
+static ULONG hash_patch(Patch* patch) {
+  UBYTE* bytes = (UBYTE*)patch;
+  ULONG hash = kFNVOffset;
+
+  for (UWORD i = 0; i < sizeof(Patch); ++ i) {
+    hash = (hash ^ bytes[i]) * kFNVPrime;
+  }
+
+  return hash;
+}
+
+static BOOL patches_equal(Patch* a,
+                          Patch* b) {
+  UBYTE* a_bytes = (UBYTE*)a;
+  UBYTE* b_bytes = (UBYTE*)b;
+
+  for (UWORD i = 0; i < sizeof(Patch); ++ i) {
+    if (a_bytes[i] != b_bytes[i]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static CacheEntry* find_cached(Patch* patch,
+                               ULONG hash) {
+  for (UWORD i = 0; i < kNumCacheEntries; ++ i) {
+    CacheEntry* entry = &g.cache[i];
+
+    if (entry->last_used && entry->hash == hash && patches_equal(&entry->patch, patch)) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+// Least recently used entry other than the one with the kept samples, which
+// may be playing.
+static CacheEntry* find_lru(BYTE* kept_samples) {
+  CacheEntry* lru_entry = NULL;
+
+  for (UWORD i = 0; i < kNumCacheEntries; ++ i) {
+    CacheEntry* entry = &g.cache[i];
+
+    if (entry->last_used && entry->samples != kept_samples &&
+        (! lru_entry || entry->last_used < lru_entry->last_used)) {
+      lru_entry = entry;
+    }
+  }
+
+  return lru_entry;
+}
+
+// Evicts entries until size more bytes fit the budget and returns a free
+// entry, or NULL if they can't fit.
+static CacheEntry* make_cache_room(ULONG size,
+                                   BYTE* kept_samples) {
+  if (size > g.cache_budget) {
+    return NULL;
+  }
+
+  for (;;) {
+    if (g.cache_size + size <= g.cache_budget) {
+      for (UWORD i = 0; i < kNumCacheEntries; ++ i) {
+        if (! g.cache[i].last_used) {
+          return &g.cache[i];
+        }
+      }
+    }
+
+    CacheEntry* lru_entry = find_lru(kept_samples);
+
+    if (! lru_entry) {
+      return NULL;
+    }
+
+    free_cache_entry(lru_entry);
+  }
+}
+
+// Keeps a copy of the sample just rendered. Caching is best effort, the
+// sample isn't kept if it doesn't fit the budget or chip memory.
+static VOID cache_sample(Patch* patch,
+                         ULONG hash,
+                         BYTE* kept_samples) {
+  ULONG chan_size = (g.num_samples + 1) & ~1;
+  ULONG size = g.samples_right ? (2 * chan_size) : chan_size;
+  CacheEntry* entry = make_cache_room(size, kept_samples);
+
+  if (! entry || ! (entry->samples = (BYTE*)AllocMem(size, MEMF_CHIP))) {
+    return;
+  }
+
+  CopyMem(g.samples, entry->samples, g.num_samples);
+
+  if (g.samples_right) {
+    CopyMem(g.samples_right, entry->samples + chan_size, g.num_samples);
+  }
+
+  entry->patch = *patch;
+  entry->hash = hash;
+  entry->last_used = ++ g.cache_clock;
+  entry->size = size;
+  entry->stereo = (g.samples_right != NULL);
+  entry->num_samples = g.num_samples;
+  entry->loop_start = g.loop_start;
+  entry->packed_size = g.packed_size;
+  g.cache_size += size;
+}
+
+static VOID use_cached(CacheEntry* entry) {
+  ULONG chan_size = (entry->num_samples + 1) & ~1;
+
+  entry->last_used = ++ g.cache_clock;
+  g.samples = entry->samples;
+  g.samples_right = entry->stereo ? (entry->samples + chan_size) : NULL;
+  g.num_samples = entry->num_samples;
+  g.loop_start = entry->loop_start;
+  g.packed_size = entry->packed_size;
+}
+
+// Renders the patch at the given rate with oscillator 1 playing the pitch note.
+static BOOL render_sample(PTNote* rate,
+                          UWORD length_ms,
+                          PTNote* pitch) {
+  BOOL ret = TRUE;
+
+  UWORD rate_freq = freq_from_note(rate);
+  UWORD osc1_octave = g.octave_base + pitch->pt_octave;
+  UWORD gain = db_scale_lookup(g.gain_db / (10 / kDbScaleSteps));
+
+  UWORD osc1_total_semis = (osc1_octave * 12) + pitch->semitone;
+  UWORD osc2_total_semis = osc1_total_semis + g.osc_detune;
+  ULONG osc1_freq = osc_freq_from_semis(osc1_total_semis);
+  ULONG osc2_freq = osc_freq_from_semis(osc2_total_semis);
+
+  // Detune sets the unison spread when oscillator 2 is replaced by unison voices.
+  UWORD unison_spread = g.osc_detune * kUnisonCentsPerDetune;
+
+  CHECK(synth_generate(g.synth, g.osc1_wave, g.osc2_wave, g.custom_wave, g.osc_mix, g.osc_couple, rate_freq,
+                       osc1_freq, osc2_freq, g.fine_tune, g.unison_voices, unison_spread,
+                       length_ms, g.cutoff, g.shape, gain, g.normalize, g.dither, g.stereo, g.stereo_width,
+                       &g.amp_env, &g.samples, &g.samples_right, &g.num_samples,
+                       &g.loop_start));
+
+ cleanup:
+  return ret;
+}
+
+// Pitched at the rate note, so it plays at its own pitch on that note.
+static BOOL render_patch() {
+  BOOL ret = TRUE;
+
+  PTNote rate;
+  UWORD length_ms;
+  model_get_render_size(&rate, &length_ms);
+
+  CHECK(render_sample(&rate, length_ms, &rate));
+
+  g.packed_size = exporter_estimate_size(g.samples, g.samples_right, g.num_samples);
+
+ cleanup:
+  return ret;
+}
+
+// Patches already rendered are taken from the cache.
 static BOOL make_sample() {
   BOOL ret = TRUE;
 
   if (g.samples_dirty) {
     g.samples_dirty = FALSE;
 
-    UWORD rate_freq = freq_from_note(&g.sample_rate);
-    UWORD oct8_freq = Octave8Freqs[g.sample_rate.semitone];
-    UWORD osc1_octave = g.octave_base + g.sample_rate.pt_octave;
-    UWORD osc1_freq = DIV_ROUND_NEAREST(oct8_freq, (1 << (8 - osc1_octave)));
-    UWORD gain = db_scale_lookup(g.gain_db / (10 / kDbScaleSteps));
+    Patch patch;
+    model_get_patch(&patch);
 
-    UWORD osc1_total_semis = (osc1_octave * 12) + g.sample_rate.semitone;
-    UWORD osc2_total_semis = osc1_total_semis + g.osc_detune;
-    UWORD osc2_octave = osc2_total_semis / 12;
-    UWORD osc2_semitone = osc2_total_semis % 12;
-    UWORD oct8_freq_2 = Octave8Freqs[osc2_semitone];
-    UWORD osc2_freq = DIV_ROUND_NEAREST(oct8_freq_2, (1 << (8 - osc2_octave)));
+    ULONG hash = hash_patch(&patch);
+    CacheEntry* entry = find_cached(&patch, hash);
 
-    CHECK(synth_generate(g.osc1_wave, g.osc2_wave, g.osc_mix, rate_freq,
-                         osc1_freq, osc2_freq, g.length_ms, g.cutoff, gain,
-                         &g.amp_env, &g.samples, &g.num_samples));
+    if (entry) {
+      use_cached(entry);
+    }
+    else {
+      // Previous sample may still be playing when exporting.
+      BYTE* prev_samples = g.samples;
+
+      CHECK(render_patch());
+      cache_sample(&patch, hash, prev_samples);
+    }
   }
 
  cleanup:
@@ -215,7 +665,7 @@ BOOL model_play_note(PTNote* note) {
 
   player_stop();
   CHECK(make_sample());
-  player_start(g.samples, g.num_samples, period_from_note(note));
+  player_start(g.samples, g.samples_right, g.num_samples, period_from_note(note));
 
 cleanup:
   return ret;
@@ -224,9 +674,435 @@ cleanup:
 BOOL model_export_sample() {
   BOOL ret = TRUE;
 
+  PTNote rate;
+  UWORD length_ms;
+  model_get_render_size(&rate, &length_ms);
+
   CHECK(make_sample());
-  CHECK(exporter_save(g.samples, g.num_samples, freq_from_note(&g.sample_rate)));
+  CHECK(exporter_save(g.export_format, g.export_name, g.samples, g.samples_right, g.num_samples,
+                      g.loop_start, freq_from_note(&rate), g.fib_delta));
+
+cleanup:
+  return ret;
+}
+
+// Export name with a _NN suffix, shortened to leave room for it the same way
+// the exporter truncates names.
+static VOID make_numbered_name(BYTE name[kExportNameMaxLen],
+                               UWORD number) {
+  UWORD name_len = MIN(str_len(g.export_name), kExportNameMaxLen - 1 - kNumberSuffixLen);
+
+  CopyMem(g.export_name, name, name_len);
+  name[name_len] = '_';
+  name[name_len + 1] = '0' + (number / 10);
+  name[name_len + 2] = '0' + (number % 10);
+  name[name_len + kNumberSuffixLen] = '\0';
+}
+
+// Each note of the keymap range is rendered at the same rate with its own
+// pitch, so all play back at their pitch on one period. The export name gets
+// a _NN suffix numbered from C-1, and with 8SVX the next note renders while
+// the previous one is written.
+BOOL model_export_keymap() {
+  BOOL ret = TRUE;
+
+  PTNote rate;
+  UWORD length_ms;
+  model_get_render_size(&rate, &length_ms);
+
+  // The patch is left rendered at the last note's pitch.
+  g.samples_dirty = TRUE;
+
+  for (UWORD note_idx = g.keymap_low; note_idx <= g.keymap_high; ++ note_idx) {
+    PTNote pitch = {
+      .semitone = note_idx % 12,
+      .pt_octave = note_idx / 12,
+    };
+
+    BYTE name[kExportNameMaxLen];
+    make_numbered_name(name, note_idx);
+
+    CHECK(render_sample(&rate, length_ms, &pitch));
+    CHECK(exporter_save(g.export_format, name, g.samples, g.samples_right, g.num_samples,
+                        g.loop_start, freq_from_note(&rate), g.fib_delta));
+  }
 
 cleanup:
   return ret;
 }
+
+BOOL model_export_generator() {
+  BOOL ret = TRUE;
+  APTR gen;
+  ULONG gen_size;
+  APTR patch;
+  ULONG patch_size;
+  ULONG work_size;
+  ULONG render_cycles;
+
+  // The generator is made from the synth's last render, which a cached
+  // sample may not come from.
+  CHECK(render_patch());
+  g.samples_dirty = FALSE;
+
+  CHECK(synth_make_generator(g.synth, &gen, &gen_size, &patch, &patch_size, &work_size, &render_cycles));
+  CHECK(exporter_save_generator(g.export_name, gen, gen_size, patch, patch_size, work_size, render_cycles));
+
+cleanup:
+  return ret;
+}
+
+ULONG model_export_signal() {
+  return exporter_done_signal();
+}
+
+BOOL model_export_finish() {
+  return exporter_finish();
+}
+
+VOID model_get_patch(Patch* out_patch) {
+  out_patch->version = kPatchVersion;
+  out_patch->osc1_wave = g.osc1_wave;
+  out_patch->osc2_wave = g.osc2_wave;
+  out_patch->osc_mix = g.osc_mix;
+  out_patch->osc_detune = g.osc_detune;
+  out_patch->osc_couple = g.osc_couple;
+  out_patch->unison_voices = g.unison_voices;
+  out_patch->fine_tune = g.fine_tune;
+  out_patch->rate_semitone = g.sample_rate.semitone;
+  out_patch->rate_pt_octave = g.sample_rate.pt_octave;
+  out_patch->octave_base = g.octave_base;
+  out_patch->shape = g.shape;
+  out_patch->length_ms = g.length_ms;
+  out_patch->cutoff = g.cutoff;
+  out_patch->gain_db = g.gain_db;
+  out_patch->normalize = g.normalize;
+  out_patch->dither = g.dither;
+  out_patch->stereo = g.stereo;
+  out_patch->stereo_width = g.stereo_width;
+  out_patch->size_budget = g.size_budget;
+  out_patch->amp_env = g.amp_env;
+  CopyMem(g.custom_wave, out_patch->custom_wave, sizeof(out_patch->custom_wave));
+}
+
+// Sets all sound parameters at once, the sample is rendered again on next use.
+// Values that would index past a table are rejected, leaving the model as is.
+BOOL model_set_patch(Patch* patch) {
+  BOOL ret = TRUE;
+
+  UWORD rate_idx = (patch->rate_pt_octave * 12) + patch->rate_semitone;
+
+  CHECK(patch->version >= 1 && patch->version <= kPatchVersion);
+  CHECK(patch->osc1_wave < kNumWaves && patch->osc2_wave < kNumWaves);
+  CHECK(patch->osc_mix <= 100 && patch->osc_detune <= kMaxOscDetune);
+  CHECK(patch->osc_couple < kNumCouples);
+  CHECK(patch->unison_voices >= 1 && patch->unison_voices <= kMaxUnisonVoices);
+  CHECK(patch->rate_semitone < 12 && rate_idx <= kMaxSampleRateIdx);
+  CHECK(patch->fine_tune <= 1);
+  CHECK(patch->octave_base >= kMinOctaveBase && patch->octave_base <= kMaxOctaveBase);
+  CHECK(patch->shape < kNumShapes);
+  CHECK(patch->length_ms >= kMinLengthMs && patch->length_ms <= kMaxLengthMs);
+  CHECK(patch->cutoff >= kMinCutoff && patch->cutoff <= kMaxCutoff);
+  CHECK(patch->gain_db <= kDbScaleRange * 10);
+  CHECK(patch->normalize <= 1 && patch->dither <= 1);
+  CHECK(patch->stereo < kNumStereoModes && patch->stereo_width <= 100);
+  CHECK(! patch->size_budget ||
+        (patch->size_budget >= kMinSizeBudgetSteps * kSizeBudgetStep &&
+         patch->size_budget <= kMaxSizeBudgetSteps * kSizeBudgetStep && ! (patch->size_budget % kSizeBudgetStep)));
+
+  // Envelope segments must fit in order, the synth divides by the release length.
+  CHECK(patch->amp_env.release &&
+        patch->amp_env.attack + patch->amp_env.decay <= kUByteMax - patch->amp_env.release);
+
+  g.osc1_wave = patch->osc1_wave;
+  g.osc2_wave = patch->osc2_wave;
+  g.osc_mix = patch->osc_mix;
+  g.osc_detune = patch->osc_detune;
+  g.osc_couple = patch->osc_couple;
+  g.unison_voices = patch->unison_voices;
+  g.fine_tune = patch->fine_tune;
+  g.sample_rate.semitone = patch->rate_semitone;
+  g.sample_rate.pt_octave = patch->rate_pt_octave;
+  g.octave_base = patch->octave_base;
+  g.shape = patch->shape;
+  g.length_ms = patch->length_ms;
+  g.cutoff = patch->cutoff;
+  g.gain_db = patch->gain_db;
+  g.normalize = patch->normalize;
+  g.dither = patch->dither;
+  g.stereo = patch->stereo;
+  g.stereo_width = patch->stereo_width;
+  g.size_budget = patch->size_budget;
+  g.amp_env = patch->amp_env;
+  CopyMem(patch->custom_wave, g.custom_wave, sizeof(g.custom_wave));
+  g.samples_dirty = TRUE;
+
+cleanup:
+  return ret;
+}
+
+// Patch files are a few dozen bytes, the name gets a .beep extension.
+BOOL model_save_patch(STRPTR name) {
+  PatchFile file = {
+    .form_hdr = { ID_FORM, sizeof(file) - (2 * sizeof(ULONG)), ID_BEEP },
+    .parm_hdr = { ID_PARM, sizeof(file.patch) },
+  };
+
+  model_get_patch(&file.patch);
+
+  return exporter_save_patch(name, &file, sizeof(file));
+}
+
+// Fields missing from patches of older versions keep their current values.
+BOOL model_load_patch(STRPTR name) {
+  BOOL ret = TRUE;
+  PatchFile file;
+  ULONG read_size;
+  ULONG hdr_size = sizeof(file.form_hdr) + sizeof(file.parm_hdr);
+
+  model_get_patch(&file.patch);
+
+  CHECK(exporter_load_patch(name, &file, sizeof(file), &read_size));
+  CHECK(read_size > hdr_size);
+  CHECK(file.form_hdr[0] == ID_FORM && file.form_hdr[2] == ID_BEEP && file.parm_hdr[0] == ID_PARM);
+  CHECK(file.parm_hdr[1] <= read_size - hdr_size);
+  CHECK(model_set_patch(&file.patch));
+
+cleanup:
+  return ret;
+}
+
+// Cached samples beyond a lowered budget are freed straight away.
+ULONG model_get_cache_budget() {
+  return g.cache_budget;
+}
+
+VOID model_set_cache_budget(ULONG cache_budget) {
+  g.cache_budget = cache_budget;
+
+  for (CacheEntry* entry; g.cache_size > g.cache_budget && (entry = find_lru(g.samples)); ) {
+    free_cache_entry(entry);
+  }
+}
+
+// Slots start out as the default patch, storing copies the current one.
+VOID model_store_slot(UWORD slot) {
+  model_get_patch(&g.bank[slot]);
+}
+
+// A rejected slot leaves the patch and the morph ends as they were.
+BOOL model_recall_slot(UWORD slot) {
+  BOOL ret = TRUE;
+
+  CHECK(model_set_patch(&g.bank[slot]));
+
+  g.recalled_slots[0] = g.recalled_slots[1];
+  g.recalled_slots[1] = slot;
+
+cleanup:
+  return ret;
+}
+
+static UWORD morph_linear(UWORD from,
+                          UWORD to,
+                          UWORD step,
+                          UWORD num_steps) {
+  return from + DIV_ROUND_NEAREST(((LONG)to - from) * step, num_steps);
+}
+
+static UWORD morph_nearest(UWORD from,
+                           UWORD to,
+                           UWORD step,
+                           UWORD num_steps) {
+  return ((2 * step) < num_steps) ? from : to;
+}
+
+// Choices such as waves and the rate switch half way. Amounts, times and the
+// cutoff are linear, gain is too but in dB, so it's logarithmic in amplitude.
+// The size budget is linear in knob steps, switching half way to or from off.
+static VOID morph_patch(Patch* from,
+                        Patch* to,
+                        UWORD step,
+                        UWORD num_steps,
+                        Patch* out_patch) {
+  *out_patch = *from;
+
+  out_patch->osc1_wave = morph_nearest(from->osc1_wave, to->osc1_wave, step, num_steps);
+  out_patch->osc2_wave = morph_nearest(from->osc2_wave, to->osc2_wave, step, num_steps);
+  out_patch->osc_mix = morph_linear(from->osc_mix, to->osc_mix, step, num_steps);
+  out_patch->osc_detune = morph_linear(from->osc_detune, to->osc_detune, step, num_steps);
+  out_patch->osc_couple = morph_nearest(from->osc_couple, to->osc_couple, step, num_steps);
+  out_patch->unison_voices = morph_nearest(from->unison_voices, to->unison_voices, step, num_steps);
+  out_patch->fine_tune = morph_nearest(from->fine_tune, to->fine_tune, step, num_steps);
+  out_patch->rate_semitone = morph_nearest(from->rate_semitone, to->rate_semitone, step, num_steps);
+  out_patch->rate_pt_octave = morph_nearest(from->rate_pt_octave, to->rate_pt_octave, step, num_steps);
+  out_patch->octave_base = morph_nearest(from->octave_base, to->octave_base, step, num_steps);
+  out_patch->shape = morph_nearest(from->shape, to->shape, step, num_steps);
+  out_patch->length_ms = morph_linear(from->length_ms, to->length_ms, step, num_steps);
+  out_patch->cutoff = morph_linear(from->cutoff, to->cutoff, step, num_steps);
+  out_patch->gain_db = morph_linear(from->gain_db, to->gain_db, step, num_steps);
+  out_patch->normalize = morph_nearest(from->normalize, to->normalize, step, num_steps);
+  out_patch->dither = morph_nearest(from->dither, to->dither, step, num_steps);
+  out_patch->stereo = morph_nearest(from->stereo, to->stereo, step, num_steps);
+  out_patch->stereo_width = morph_linear(from->stereo_width, to->stereo_width, step, num_steps);
+  out_patch->size_budget = (from->size_budget && to->size_budget) ?
+                           morph_linear(from->size_budget / kSizeBudgetStep, to->size_budget / kSizeBudgetStep,
+                                        step, num_steps) * kSizeBudgetStep :
+                           morph_nearest(from->size_budget, to->size_budget, step, num_steps);
+  out_patch->amp_env.attack = morph_linear(from->amp_env.attack, to->amp_env.attack, step, num_steps);
+  out_patch->amp_env.decay = morph_linear(from->amp_env.decay, to->amp_env.decay, step, num_steps);
+  out_patch->amp_env.sustain = morph_linear(from->amp_env.sustain, to->amp_env.sustain, step, num_steps);
+  out_patch->amp_env.release = morph_linear(from->amp_env.release, to->amp_env.release, step, num_steps);
+
+  for (UWORD i = 0; i < kCustomWavePoints; ++ i) {
+    out_patch->custom_wave[i] = morph_linear(from->custom_wave[i] + 0x80, to->custom_wave[i] + 0x80,
+                                             step, num_steps) - 0x80;
+  }
+}
+
+// Fills the slots between the last two recalled ones with patches morphing
+// from one to the other, and renders each so they audition from the cache.
+// Rendering shares filter coefficients and the envelope table between steps
+// where these are equal. Exporting also writes both ends and the steps to
+// files numbered by slot. Returns FALSE if the slots are adjacent.
+BOOL model_morph(BOOL export_files) {
+  BOOL ret = TRUE;
+  UWORD from_slot = g.recalled_slots[0];
+  UWORD to_slot = g.recalled_slots[1];
+  WORD slot_dir = (to_slot > from_slot) ? 1 : -1;
+  UWORD num_steps = ABS((WORD)to_slot - (WORD)from_slot);
+  Patch current;
+  Patch morphed;
+
+  if (num_steps < 2) {
+    return FALSE;
+  }
+
+  model_get_patch(&current);
+
+  for (UWORD step = 0; step <= num_steps; ++ step) {
+    UWORD slot = from_slot + (step * slot_dir);
+
+    // Steps only replace their slot once they validate.
+    if (step > 0 && step < num_steps) {
+      morph_patch(&g.bank[from_slot], &g.bank[to_slot], step, num_steps, &morphed);
+      CHECK(model_set_patch(&morphed));
+      g.bank[slot] = morphed;
+    }
+    else if (export_files) {
+      CHECK(model_set_patch(&g.bank[slot]));
+    }
+    else {
+      continue;
+    }
+
+    CHECK(make_sample());
+
+    if (export_files) {
+      PTNote rate;
+      UWORD length_ms;
+      model_get_render_size(&rate, &length_ms);
+
+      BYTE name[kExportNameMaxLen];
+      make_numbered_name(name, slot);
+
+      CHECK(exporter_save(g.export_format, name, g.samples, g.samples_right, g.num_samples,
+                          g.loop_start, freq_from_note(&rate), g.fib_delta));
+    }
+  }
+
+cleanup:
+  model_set_patch(&current);
+
+  return ret;
+}
+
+// Changes between model_history_begin() and model_history_commit() are one
+// step of history, so a whole drag is undone at once.
+VOID model_history_begin() {
+  model_get_patch(&g.history_patch);
+}
+
+VOID model_history_commit() {
+  Patch patch;
+  model_get_patch(&patch);
+
+  UBYTE* old_bytes = (UBYTE*)&g.history_patch;
+  UBYTE* new_bytes = (UBYTE*)&patch;
+  UWORD num_deltas = 0;
+
+  for (UWORD i = 0; i < sizeof(Patch); ++ i) {
+    num_deltas += (old_bytes[i] != new_bytes[i]);
+  }
+
+  if (num_deltas == 0) {
+    return;
+  }
+
+  // New step replaces any that were undone, the oldest steps make room for it.
+  g.history_end = g.history_pos;
+
+  while (g.history_end + num_deltas - g.history_begin > kHistorySize) {
+    while (! (g.history[(g.history_begin ++) % kHistorySize].param & kDeltaStepEnd));
+  }
+
+  for (UWORD i = 0; i < sizeof(Patch); ++ i) {
+    if (old_bytes[i] != new_bytes[i]) {
+      Delta* delta = &g.history[(g.history_end ++) % kHistorySize];
+      delta->param = i;
+      delta->old_value = old_bytes[i];
+      delta->new_value = new_bytes[i];
+    }
+  }
+
+  g.history[(g.history_end - 1) % kHistorySize].param |= kDeltaStepEnd;
+  g.history_pos = g.history_end;
+}
+
+static BOOL apply_deltas(ULONG first,
+                         ULONG end,
+                         BOOL undo) {
+  Patch patch;
+  model_get_patch(&patch);
+
+  for (ULONG i = first; i < end; ++ i) {
+    Delta* delta = &g.history[i % kHistorySize];
+    ((UBYTE*)&patch)[delta->param & ~kDeltaStepEnd] = undo ? delta->old_value : delta->new_value;
+  }
+
+  return model_set_patch(&patch);
+}
+
+// Undo and redo set the patch as a whole, so a sample rendered for it before
+// comes from the cache. Returns FALSE if there's nothing to undo or redo.
+BOOL model_undo() {
+  if (g.history_pos == g.history_begin) {
+    return FALSE;
+  }
+
+  ULONG first = g.history_pos - 1;
+
+  while (first > g.history_begin && ! (g.history[(first - 1) % kHistorySize].param & kDeltaStepEnd)) {
+    -- first;
+  }
+
+  BOOL ret = apply_deltas(first, g.history_pos, TRUE);
+  g.history_pos = first;
+
+  return ret;
+}
+
+BOOL model_redo() {
+  if (g.history_pos == g.history_end) {
+    return FALSE;
+  }
+
+  ULONG end = g.history_pos;
+
+  while (! (g.history[(end ++) % kHistorySize].param & kDeltaStepEnd));
+
+  BOOL ret = apply_deltas(g.history_pos, end, FALSE);
+  g.history_pos = end;
+
+  return ret;
+}
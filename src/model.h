@@ -3,18 +3,50 @@
 
 #include "common.h"
 
+// Sound parameters, stored as is in the PARM chunk of patch files. Fields are
+// bytes or words in big-endian order without padding, and new versions only
+// append fields.
+typedef struct {
+  UBYTE version;
+  UBYTE osc1_wave;
+  UBYTE osc2_wave;
+  UBYTE osc_mix;
+  UBYTE osc_detune;
+  UBYTE osc_couple;
+  UBYTE unison_voices;
+  UBYTE fine_tune;
+  UBYTE rate_semitone;
+  UBYTE rate_pt_octave;
+  UBYTE octave_base;
+  UBYTE shape;
+  UWORD length_ms;
+  UWORD cutoff;
+  UWORD gain_db;
+  UBYTE normalize;
+  UBYTE dither;
+  UBYTE stereo;
+  UBYTE stereo_width;
+  UWORD size_budget;
+  Envelope amp_env;
+  BYTE custom_wave[kCustomWavePoints];
+} Patch;
+
 BOOL model_init();
 VOID model_fini();
 Wave model_get_osc1_wave();
 VOID model_set_osc1_wave(Wave wave);
 Wave model_get_osc2_wave();
 VOID model_set_osc2_wave(Wave wave);
+BYTE* model_get_custom_wave();
+VOID model_set_custom_wave(BYTE* custom_wave);
 PTNote* model_get_sample_rate();
 VOID model_set_sample_rate(PTNote* sample_rate);
 UWORD model_get_octave_base();
 VOID model_set_octave_base(UWORD octave_base);
 UWORD model_get_cutoff();
 VOID model_set_cutoff(UWORD cutoff);
+Shape model_get_shape();
+VOID model_set_shape(Shape shape);
 UWORD model_get_gain_db();
 VOID model_set_gain_db(UWORD gain_db);
 UWORD model_get_length_ms();
@@ -23,9 +55,55 @@ Envelope* model_get_amp_env();
 VOID model_set_amp_env(Envelope* amp_env);
 BOOL model_play_note(PTNote* note);
 BOOL model_export_sample();
+BOOL model_export_keymap();
+BOOL model_export_generator();
+ULONG model_export_signal();
+BOOL model_export_finish();
 UWORD model_get_osc_mix();
 void model_set_osc_mix(UWORD osc_mix);
 UWORD model_get_osc_detune();
 void model_set_osc_detune(UWORD osc_detune);
+Couple model_get_osc_couple();
+VOID model_set_osc_couple(Couple osc_couple);
+UWORD model_get_unison_voices();
+VOID model_set_unison_voices(UWORD unison_voices);
+BOOL model_get_fine_tune();
+VOID model_set_fine_tune(BOOL fine_tune);
+BOOL model_get_normalize();
+VOID model_set_normalize(BOOL normalize);
+BOOL model_get_dither();
+VOID model_set_dither(BOOL dither);
+Stereo model_get_stereo();
+VOID model_set_stereo(Stereo stereo);
+UWORD model_get_stereo_width();
+VOID model_set_stereo_width(UWORD stereo_width);
+UWORD model_get_size_budget();
+VOID model_set_size_budget(UWORD size_budget);
+VOID model_get_render_size(PTNote* out_rate,
+                           UWORD* out_length_ms);
+BOOL model_get_fib_delta();
+VOID model_set_fib_delta(BOOL fib_delta);
+UWORD model_get_keymap_low();
+VOID model_set_keymap_low(UWORD keymap_low);
+UWORD model_get_keymap_high();
+VOID model_set_keymap_high(UWORD keymap_high);
+Format model_get_export_format();
+VOID model_set_export_format(Format export_format);
+STRPTR model_get_export_name();
+VOID model_set_export_name(STRPTR export_name);
+ULONG model_get_packed_size();
+VOID model_get_patch(Patch* out_patch);
+BOOL model_set_patch(Patch* patch);
+BOOL model_save_patch(STRPTR name);
+BOOL model_load_patch(STRPTR name);
+ULONG model_get_cache_budget();
+VOID model_set_cache_budget(ULONG cache_budget);
+VOID model_store_slot(UWORD slot);
+BOOL model_recall_slot(UWORD slot);
+BOOL model_morph(BOOL export_files);
+VOID model_history_begin();
+VOID model_history_commit();
+BOOL model_undo();
+BOOL model_redo();
 
 #endif
@@ -70,13 +70,17 @@ VOID player_fini() {
   }
 }
 
-VOID player_start(BYTE* samples,
-                  UWORD num_samples,
+// Mono samples play on both channels when samples_right is NULL.
+VOID player_start(BYTE* samples_left,
+                  BYTE* samples_right,
+                  ULONG num_samples,
                   UWORD period) {
+  BYTE* chan_samples[kNumChans] = { samples_left, samples_right ? samples_right : samples_left };
+
   for (UWORD ch = 0; ch < kNumChans; ++ ch) {
     g.audio_io[ch]->ioa_Request.io_Command = CMD_WRITE;
     g.audio_io[ch]->ioa_Request.io_Flags = ADIOF_PERVOL;
-    g.audio_io[ch]->ioa_Data = samples;
+    g.audio_io[ch]->ioa_Data = chan_samples[ch];
     g.audio_io[ch]->ioa_Length = num_samples;
     g.audio_io[ch]->ioa_Period = period;
     g.audio_io[ch]->ioa_Volume = kAudioVol;
@@ -5,8 +5,9 @@
 
 BOOL player_init();
 VOID player_fini();
-VOID player_start(BYTE* samples,
-                  UWORD num_samples,
+VOID player_start(BYTE* samples_left,
+                  BYTE* samples_right,
+                  ULONG num_samples,
                   UWORD period);
 VOID player_stop();
 
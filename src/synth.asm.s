@@ -1,8 +1,16 @@
+  .globl _synth_asm_gen
   .globl _synth_asm
-  .globl _synth_asm_square
-  .globl _synth_asm_sawtooth
-  .globl _synth_asm_triangle
+  .globl _synth_asm_dispatch
+  .globl _synth_asm_loop_blocks
+  .globl _synth_asm_wave1
+  .globl _synth_asm_wave2
   .globl _synth_asm_noise
+  .globl _synth_asm_wave1_phase
+  .globl _synth_asm_wave2_phase
+  .globl _synth_asm_noise_phase
+  .globl _synth_asm_sync
+  .globl _synth_asm_ring
+  .globl _synth_asm_end
 
   || Offsets from AsmParams structure
 	.set Samples, 0x0             | Output sample buffer
@@ -10,35 +18,63 @@
 	.set Osc2Func, 0x8            | Oscillator 2 generator
 	.set FilterCoeffs, 0xC        | Low-pass filter coefficients
 	.set AmpEnvLUT, 0x10          | Amplitude envelope LUT
-	.set NumSamples, 0x14         | Number of samples to generate, range [0x100,0x7FFF]
-	.set Osc1PerInv, 0x16         | 0x10000 / (oscillator 1 period)
-	.set Osc2PerInv, 0x18         | 0x10000 / (oscillator 2 period)
-	.set NumSamplesInv, 0x1A      | 0x100 * 0x10000 / (number of samples)
+	.set Osc1PerInv, 0x14         | 0x10000 / (oscillator 1 period)
+	.set Osc2PerInv, 0x16         | 0x10000 / (oscillator 2 period)
+	.set NumSamples, 0x18         | Number of samples to generate, range [0x100,0x1FFFE]
   .set Osc1AmpScale, 0x1C       | Oscillator 1 amplitude scale, range [0x0, 0x7FFF] = [0, 1]
  	.set Osc2AmpScale, 0x1E       | Oscillator 2 amplitude scale, range [0x0, 0x7FFF] = [0, 1]
+  .set Osc1Per, 0x20            | Oscillator 1 period in samples
+  .set Osc2Sync, 0x22           | Non-zero to reset oscillator 2 phase when oscillator 1 wraps
+  .set Osc2CoupledFunc, 0x24    | Oscillator 2 generator wrapped by sync/ring coupling
+  .set ShaperLUT, 0x28          | Waveshaper LUT centered on entry 0x80, or 0 to bypass
+  .set UnisonPerInvs, 0x2C      | Zero-terminated list of 0x10000 / (voice period), or 0 for two oscillators
+  .set UnisonShift, 0x30        | log2_ceil(number of unison voices)
+  .set UnisonAmpScale, 0x32     | (1 << UnisonShift) / (number of unison voices), range [0x0, 0x7FFF] = [0, 2]
+  .set Osc1Phase, 0x34          | Oscillator 1 phase accumulator, range [0x0, 0xFFFFFFFF] = [0, 1)
+  .set Osc2Phase, 0x38          | Oscillator 2 phase accumulator
+  .set Osc1PhaseInc, 0x3C       | 0x100000000 / (oscillator 1 period), or 0 for whole-sample periods
+  .set Osc2PhaseInc, 0x40       | 0x100000000 / (oscillator 2 period)
+  .set SamplesRight, 0x44       | Right channel sample buffer, or 0 for mono
+  .set Osc1AmpScaleR, 0x48      | Oscillator 1 right channel amplitude scale, left uses Osc1AmpScale
+  .set Osc2AmpScaleR, 0x4A      | Oscillator 2 right channel amplitude scale, left uses Osc2AmpScale
+  .set StereoOscs, 0x4C         | Oscillator 2 and 1 samples kept for the right channel
+  .set StereoAmp, 0x50          | Amplitude envelope word shared by both channels
+  .set Peak, 0x52               | Largest pre-clamp |sample_byte * 0x10000| rendered
+  .set QuantErr, 0x56           | Quantization error fed back into the next sample
+  .set QuantErrR, 0x58          | Right channel quantization error
+  .set DitherMask, 0x5A         | 0xFFFF to feed back quantization error, 0 to truncate
+  .set EnvPhase, 0x5C           | Envelope position before the first sample, range [0x0, 0xFFFFFFFF] = [0, 1)
+  .set EnvPhaseInc, 0x60        | 0x100000000 / (number of samples)
+  .set NoiseLUT, 0x64           | Noise table, NoiseTableSize words
+  .set OscWaves, 0x68           | Oscillator 1 and 2 band-limited wavetables, WaveTableSize words each
+  .set ParamsSize, 0x468        | sizeof(AsmParams)
 
-_synth_asm:
-  movem.l d0-d7/a0-a6,-(sp)
+  || Offsets from GenPatch structure, the AsmParams follow it up to OscWaves
+  .set GenLoopStart, 0x0        | Loop start for the replay, not used by the generator
+  .set GenLoopEnd, 0x4          | Samples per channel to play, the rest is past the loop end
+  .set GenRightOffset, 0x8      | Right channel copied from the left at this offset, or 0
+  .set GenRightDelay, 0xC       | Silent bytes before the copy, the Haas delay
+  .set GenRightLen, 0x10        | Bytes copied
+  .set GenAmpGain, 0x14         | Amplitude envelope gain
+  .set GenAmpEnv, 0x16          | Amplitude envelope attack, decay, sustain and release bytes
+  .set GenWaveOffsets, 0x1A     | Offset of each oscillator's wave entries from the patch
+  .set GenWaveKinds, 0x1E       | Byte per oscillator, 0 none, 1 custom, 2 odd, 3 odd and quarter-wave symmetric
+  .set GenShaperOffset, 0x20    | Offset of the shaper entries from the patch, or 0 when off
+  .set GenParams, 0x22          | AsmParams without OscWaves
 
-  move.l Samples(a0),a5
-  move.l Osc1Func(a0),a4
-  move.l Osc2Func(a0),a3
-  move.l FilterCoeffs(a0),a2
-  move.l AmpEnvLUT(a0),a1
-  move.w NumSamples(a0),d6
-  move.l Osc1PerInv(a0),d5      | 0x10000 / (oscillator 1 and 2 period) in two words
-  move.w NumSamplesInv(a0),d4
+  .set WaveTableSize, 0x100     | Wavetable entries per cycle
+  .set NoiseTableSize, 0x800    | Noise table entries
+  .set AmpEnvLUTSize, 0x100     | Amplitude envelope LUT entries
+  .set ShaperTableSize, 0x100   | Waveshaper LUT entries
+  .set CustomWavePoints, 0x20   | Custom wave points per cycle
 
-  moveq.l #0x0,d7               | Sample number = 0
-  move.l d7,-(sp)               | Unused = 0, Random seed = 0
-  move.l d7,-(sp)               | Filter state: x[n-1] = x[n-2] = 0
-  move.l d7,-(sp)               | Filter state: y[n-1] = y[n-2] = 0
-
-  move.l #0x20,d7
-
-.sample_loop:
-  || FIXME: Check whether [0x80, 0x7F] can overflow, generate [0x81, 0x7F] instead?
+  || Offsets from the work area of a generator, tables follow the AsmParams
+  .set GenAmpEnvLUT, ParamsSize
+  .set GenShaperLUT, GenAmpEnvLUT + (AmpEnvLUTSize * 2)
+  .set GenNoiseLUT, GenShaperLUT + (ShaperTableSize * 2)
 
+  || Oscillators at the sample index, oscillator 1 sample to d3.w, oscillator 2 sample to d0.w.
+  .macro OSC_INDEX
   || Oscillator 1
   move.l d7,d0
   swap d5                       | Oscillator 1 period to low word
@@ -47,18 +83,48 @@ _synth_asm:
 
   || Oscillator 2
   move.l d7,d0
-	swap d5                       | Oscillator 2 period to low word
+  swap d5                       | Oscillator 2 period to low word
   jsr (a3)
+  .endm
 
-  || Oscillator mix
-  muls.w Osc1AmpScale(a0),d3
- 	muls.w Osc2AmpScale(a0),d0
+  || Oscillators at their phase accumulators, same outputs as OSC_INDEX.
+  .macro OSC_PHASE
+  || Oscillator 1, fractional period
+  move.l Osc1Phase(a0),d0
+  add.l Osc1PhaseInc(a0),d0
+  bcc .osc1_no_wrap\@           | Test carry before the store clears it
+  tst.w Osc2Sync(a0)
+  beq .osc1_no_wrap\@
+  clr.l Osc2Phase(a0)           | Hard sync oscillator 2 at oscillator 1 phase reset
+.osc1_no_wrap\@:
+  move.l d0,Osc1Phase(a0)
+  swap d0                       | Phase [0,0xFFFF] to low word
+  swap d5                       | Oscillator 1 period to low word
+  jsr (a4)
+  move.w d0,d3
+
+  || Oscillator 2, fractional period
+  move.l Osc2Phase(a0),d0
+  add.l Osc2PhaseInc(a0),d0
+  move.l d0,Osc2Phase(a0)
+  swap d0                       | Phase [0,0xFFFF] to low word
+  swap d5                       | Oscillator 2 period to low word
+  jsr (a3)
+  .endm
+
+  || Scale and sum oscillator 1 sample in d3.w with oscillator 2 sample in d0.w.
+  .macro OSC_MIX amp1, amp2
+  muls.w \amp1(a0),d3
+  muls.w \amp2(a0),d0
   swap d3
- 	swap d0
+  swap d0
   lsl.w #0x1,d3
   lsl.w #0x1,d0
   add.w d3,d0
+  .endm
 
+  || Filter the sample in d0.w, filter state at (sp), and shape it if shape is set.
+  .macro FILTER_SHAPE shape
   || Low-pass 2nd order Butterworth filter
   move.l (sp)+,d1               | x[n-1], y[n-1]
   move.l (sp),d2                | x[n-2], y[n-2]
@@ -81,83 +147,544 @@ _synth_asm:
   lsl.w #0x2,d0                 | signed FP rescale >> 15, coefficient scale << 1
   move.w d0,-(sp)               | Current y[n] becomes next y[n-1]
 
-  || Amplitude envelope
-  move.l d7,d1
-  mulu.w d4,d1                  | (i * 0x100 * 0x10000) / num_samples
-  swap d1                       | x = (i * 0x100) / num_samples, range [0,FF]
-  lsl.w #0x1,d1                 | x indexes words instead of bytes
+  .if \shape
+  || Waveshaper
+  move.w d0,d1
+  asr.w #0x8,d1                 | x = sample_word >> 8, range [-0x80,0x7F]
+  add.w d1,d1                   | x indexes words instead of bytes
+  move.w (a6,d1.w),d0           | sample_word = shaper_lut[x]
+  .endif
+  .endm
+
+  || Amplitude envelope word for the next sample to d1.w.
+  || Position accumulates in d4, no multiply by the sample number.
+  .macro AMP_ENV
+  add.l EnvPhaseInc(a0),d4      | (i * 0x100000000) / num_samples
+  move.l d4,d1
+  swap d1
+  lsr.w #0x7,d1                 | x = (i * 0x100) / num_samples, range [0,FF]
+  and.w #0x1FE,d1               | x indexes words instead of bytes
   move.w (a1,d1.w),d1           | amp_word = amp_env_lut[x]
-  muls.w d1,d0
+  .endm
+
+  || Scale the sample in d0.w by the envelope word in amp, track the peak, quantize
+  || with the error fed back from the previous sample in err if dither is set and
+  || clamp to d0.b.
+  .macro AMP_CLAMP amp, err, dither
+  muls.w \amp,d0
+  move.l d0,d1
+  bpl .peak_abs\@
+  neg.l d1
+.peak_abs\@:
+  cmp.l Peak(a0),d1
+  bls .peak_kept\@
+  move.l d1,Peak(a0)            | New pre-clamp peak
+.peak_kept\@:
+
+  .if \dither
+  || First-order error feedback, shapes quantization noise towards Nyquist
+  moveq.l #0x0,d1
+  move.w \err(a0),d1
+  add.l d1,d0                   | Add fraction truncated from the previous sample
+  move.w d0,\err(a0)            | Fraction truncated from this sample
+  .endif
+
   swap d0                       | sample_byte = (sample_word * amp_word) >> 16
   move.w d0,d1
   move.w #0xFF80,d2
   and.w d2,d1                   | check for positive overflow in upper byte
-  beq .sample_out
+  beq .clamped\@
   cmp.w d2,d1                   | check for negative overflow in upper byte
-  beq .sample_out
+  beq .clamped\@
   rol.w #0x1,d1                 | move sign bit to bit 0
   add.b #0x7F,d1                | clamp result to +/- 0x7F
   move.b d1,d0
+.clamped\@:
+  .endm
 
-  ||lsr.w #0x8,d0
-
-.sample_out:
+  || Filter, shape, envelope and store the oscillator sample in d0.w.
+  || Shared tail of the mono loops, branches back to loop until done.
+  .macro SAMPLE_POST loop, shape, dither
+  FILTER_SHAPE \shape
+  AMP_ENV
+  AMP_CLAMP d1, QuantErr, \dither
   move.b d0,(a5)+
-  addq.w #0x1,d7
-  cmp.w d7,d6
-  bne .sample_loop
+  addq.l #0x1,d7
+  cmp.l d7,d6
+  bne \loop
+  .endm
 
-  add.l #0xC,sp                 | Pop state from stack
+  || Mix, filter, shape, envelope and store both channels from the oscillator samples in d3.w, d0.w.
+  || Right channel filter state at 0x8(sp), right samples at d6.l bytes from the left.
+  || Shared tail of the stereo loops, branches back to loop until done.
+  .macro STEREO_POST loop, shape, dither
+  movem.w d0/d3,StereoOscs(a0)  | Keep oscillator samples for the right channel
+
+  || Left channel
+  OSC_MIX Osc1AmpScale, Osc2AmpScale
+  FILTER_SHAPE \shape
+  AMP_ENV
+  move.w d1,StereoAmp(a0)       | Envelope computed once for both channels
+  AMP_CLAMP d1, QuantErr, \dither
+  move.b d0,(a5)
+
+  || Right channel
+  movem.w StereoOscs(a0),d0/d3
+  OSC_MIX Osc1AmpScaleR, Osc2AmpScaleR
+  addq.l #0x8,sp                | Right channel filter state to top of stack
+  FILTER_SHAPE \shape
+  subq.l #0x8,sp
+  AMP_CLAMP StereoAmp(a0), QuantErrR, \dither
+  move.b d0,(a5,d6.l)
+
+  addq.l #0x1,a5
+  addq.l #0x1,d7
+  cmp.l NumSamples(a0),d7
+  bne \loop
+  .endm
+
+  || Restore registers and return, ends each loop so it can be copied on its own.
+  .macro LOOP_DONE
+  lea 0x10(sp),sp               | Pop state from stack
   movem.l (sp)+,d0-d7/a0-a6
   rts
+  .endm
 
-_synth_asm_square:
-  || Square wave oscillator
-  mulu.w d5,d0                  | (i * 0x10000) / osc_per
-  lsl.l #0x1,d0                 | (i * 0x10000) / osc_half_per
-  swap d0                       | i / osc_half_per
-  and.w #0x1,d0
-  add.w #0x7FFF,d0              | 0x7FFF in phase 0-50%, 0x8000 in phase 50-100%
+  || Branch to the loop of the set named by suffix that renders the AsmParams at a0.
+  .macro LOOP_DISPATCH suffix
+  tst.l UnisonPerInvs(a0)
+  bne _synth_asm_unison\suffix\()_loop
+  tst.l SamplesRight(a0)
+  beq .mono\@
+  tst.l Osc1PhaseInc(a0)
+  bne _synth_asm_stereo_phase\suffix\()_loop
+  bra _synth_asm_stereo\suffix\()_loop
+.mono\@:
+  tst.l Osc1PhaseInc(a0)
+  bne _synth_asm_phase\suffix\()_loop
+  bra _synth_asm_sample\suffix\()_loop
+  .endm
+
+  || One of each loop, with the waveshaper if shape is set and error feedback if
+  || dither is set, so the loops themselves never test for either. Labels end in
+  || suffix, then _loop. Each loop is self-contained and position-independent.
+  .macro LOOP_SET shape, dither, suffix
+_synth_asm_sample\suffix\()_loop:
+.sample_loop\@:
+  || FIXME: Check whether [0x80, 0x7F] can overflow, generate [0x81, 0x7F] instead?
+  OSC_INDEX
+  OSC_MIX Osc1AmpScale, Osc2AmpScale
+  SAMPLE_POST .sample_loop\@, \shape, \dither
+  LOOP_DONE
+
+_synth_asm_phase\suffix\()_loop:
+.phase_loop\@:
+  OSC_PHASE
+  OSC_MIX Osc1AmpScale, Osc2AmpScale
+  SAMPLE_POST .phase_loop\@, \shape, \dither
+  LOOP_DONE
+
+_synth_asm_stereo\suffix\()_loop:
+  move.l SamplesRight(a0),d6
+  sub.l a5,d6                   | Right samples offset from left
+.stereo_loop\@:
+  OSC_INDEX
+  STEREO_POST .stereo_loop\@, \shape, \dither
+  LOOP_DONE
+
+_synth_asm_stereo_phase\suffix\()_loop:
+  move.l SamplesRight(a0),d6
+  sub.l a5,d6                   | Right samples offset from left
+.stereo_phase_loop\@:
+  OSC_PHASE
+  STEREO_POST .stereo_phase_loop\@, \shape, \dither
+  LOOP_DONE
+
+_synth_asm_unison\suffix\()_loop:
+.unison_loop\@:
+  || Unison voices of oscillator 1, summed in d3
+  move.l UnisonPerInvs(a0),a3   | Zero-terminated 0x10000 / (voice period) list
+  moveq.l #0x0,d3
+  move.w (a3)+,d5               | First voice period to low word
+
+.unison_voice\@:
+  move.l d7,d0
+  jsr (a4)
+  ext.l d0
+  add.l d0,d3
+  move.w (a3)+,d5               | Next voice period to low word
+  bne .unison_voice\@
+
+  || Unison gain compensation
+  move.w UnisonShift(a0),d1
+  asr.l d1,d3                   | sum >> log2_ceil(voices), fits in a word
+  muls.w UnisonAmpScale(a0),d3
+  swap d3
+  lsl.w #0x2,d3                 | unsigned FP rescale >> 14
+  move.w d3,d0                  | sample_word = sum / voices
+
+  SAMPLE_POST .unison_loop\@, \shape, \dither
+  LOOP_DONE
+  .endm
+
+  || Add d0 to a pointer field in the AsmParams at a0, unless it is null.
+  .macro RELOC field
+  tst.l \field(a0)
+  beq .reloc_null\@
+  add.l d0,\field(a0)
+.reloc_null\@:
+  .endm
+
+  || Generator routines exported for intros start here and continue into
+  || synth_asm's prologue, followed by one loop and the oscillators it calls.
+  || a0 = patch, GenPatch with offsets in place of pointers, a1 = sample buffer,
+  || a2 = work area, where the AsmParams and the tables the patch leaves out are
+  || built. The patch is only read, so it can be rendered again.
+_synth_asm_gen:
+  movem.l d0-d7/a0-a6,-(sp)
+  move.l a0,a3                  | Patch
+  move.l a1,a4                  | Sample buffer
+  move.l a2,a5                  | Work area, AsmParams first
+
+  lea GenParams(a3),a0
+  move.l a5,a1
+  moveq.l #((OscWaves / 4) - 1),d0
+.gen_params:
+  move.l (a0)+,(a1)+
+  dbf d0,.gen_params
+
+  move.l a5,a0
+  move.l a4,Samples(a0)
+  move.l a4,d0
+  RELOC SamplesRight            | Right channel offset from the sample buffer
+  lea _synth_asm_gen(pc),a1     | Oscillator offsets are from the generator start
+  move.l a1,d0
+  RELOC Osc1Func
+  RELOC Osc2Func
+  RELOC Osc2CoupledFunc
+  move.l a3,d0                  | Table offsets are from the patch start
+  RELOC FilterCoeffs
+  RELOC UnisonPerInvs
+
+  || Amplitude envelope LUT, as make_amp_env_lut() builds it
+  lea GenAmpEnvLUT(a5),a1
+  move.l a1,AmpEnvLUT(a5)
+  moveq.l #0x0,d4
+  moveq.l #0x0,d5
+  moveq.l #0x0,d6
+  moveq.l #0x0,d7
+  lea GenAmpEnv(a3),a0
+  move.b (a0)+,d4               | Attack
+  move.b (a0)+,d5               | Decay
+  move.b (a0)+,d6               | Sustain
+  move.b (a0)+,d7               | Release
+  moveq.l #0x0,d1               | i
+.gen_env:
+  cmp.w d4,d1
+  bcc .gen_env_decay
+  move.w d1,d0
+  mulu.w #0xFF,d0
+  divu.w d4,d0                  | amp = (i * 0xFF) / attack
+  bra .gen_env_gain
+.gen_env_decay:
+  move.w d1,d0
+  sub.w d4,d0
+  cmp.w d5,d0
+  bcc .gen_env_sustain
+  move.w #0xFF,d2
+  sub.w d6,d2
+  mulu.w d2,d0
+  divu.w d5,d0
+  neg.w d0
+  add.w #0xFF,d0                | amp = 0xFF - ((0xFF - sustain) * (i - attack)) / decay
+  bra .gen_env_gain
+.gen_env_sustain:
+  move.w d1,d0
+  add.w d7,d0
+  cmp.w #0xFF,d0
+  bcc .gen_env_release
+  move.w d6,d0                  | amp = sustain
+  bra .gen_env_gain
+.gen_env_release:
+  sub.w #0xFF,d0
+  mulu.w d6,d0
+  divu.w d7,d0
+  neg.w d0
+  add.w d6,d0                   | amp = sustain - (sustain * (i - (0xFF - release))) / release
+.gen_env_gain:
+  and.l #0xFF,d0                | Drop the remainder
+  mulu.w GenAmpGain(a3),d0
+  lsr.l #0x8,d0
+  cmp.l #0x7FFF,d0
+  bls .gen_env_store
+  move.w #0x7FFF,d0
+.gen_env_store:
+  move.w d0,(a1)+
+  addq.w #0x1,d1
+  cmp.w #AmpEnvLUTSize,d1
+  bne .gen_env
+
+  || Noise table, the LFSR gentables.c fills NoiseTable with
+  lea GenNoiseLUT(a5),a1
+  move.l a1,NoiseLUT(a5)
+  moveq.l #0x0,d0               | seed
+  move.w #(NoiseTableSize - 1),d1
+.gen_noise:
+  tst.w d0
+  bne .gen_noise_step
+  move.w #0xC2DF,d0
+  bra .gen_noise_store
+.gen_noise_step:
+  add.w d0,d0
+  bcc .gen_noise_store          | Carry from the top bit
+  beq .gen_noise_store
+  eor.w #0xC2DF,d0
+.gen_noise_store:
+  move.w d0,(a1)+
+  dbf d1,.gen_noise
+
+  || Oscillator wavetables, every kind but custom is odd around entry 0x80
+  lea OscWaves(a5),a2
+  moveq.l #0x0,d7               | Oscillator
+.gen_wave:
+  moveq.l #0x0,d0
+  move.b GenWaveKinds(a3,d7.w),d0
+  beq .gen_wave_next
+  move.w d7,d1
+  add.w d1,d1
+  move.l a3,a0
+  add.w GenWaveOffsets(a3,d1.w),a0
+  move.l a2,a1
+  subq.b #0x1,d0
+  bne .gen_wave_odd
+
+  || Custom wave, linear interpolation between the points as load_wave_table() does
+  moveq.l #(CustomWavePoints - 1),d3
+.gen_custom_point:
+  move.b (a0)+,d4
+  ext.w d4                      | from
+  tst.w d3
+  bne .gen_custom_to
+  sub.w #CustomWavePoints,a0    | Last point runs to the first
+.gen_custom_to:
+  move.b (a0),d5
+  ext.w d5
+  sub.w d4,d5                   | to - from
+  lsl.w #0x3,d4                 | from * stride
+  moveq.l #((WaveTableSize / CustomWavePoints) - 1),d6
+.gen_custom_frac:
+  move.w d4,d0
+  lsl.w #0x5,d0                 | (from * (stride - frac) + to * frac) * (0x100 / stride)
+  move.w d0,(a1)+
+  add.w d5,d4
+  dbf d6,.gen_custom_frac
+  dbf d3,.gen_custom_point
+  bra .gen_wave_next
+
+.gen_wave_odd:
+  clr.w (a1)+                   | Entry 0x0
+  subq.b #0x1,d0
+  bne .gen_wave_quarter
+  || Sawtooth, entries 0x1 to 0x7F stored
+  moveq.l #((WaveTableSize / 2) - 2),d3
+.gen_half:
+  move.w (a0)+,(a1)+
+  dbf d3,.gen_half
+  bra .gen_wave_mirror
+
+.gen_wave_quarter:
+  || Square and triangle, entries 0x1 to 0x40 stored, 0x41 to 0x7F mirror them
+  moveq.l #((WaveTableSize / 4) - 1),d3
+.gen_quarter:
+  move.w (a0)+,(a1)+
+  dbf d3,.gen_quarter
+  lea -0x2(a1),a0
+  moveq.l #((WaveTableSize / 4) - 2),d3
+.gen_unfold:
+  move.w -(a0),(a1)+
+  dbf d3,.gen_unfold
+
+.gen_wave_mirror:
+  clr.w (a1)+                   | Entry 0x80
+  lea -0x2(a1),a0
+  moveq.l #((WaveTableSize / 2) - 2),d3
+.gen_mirror:
+  move.w -(a0),d0
+  neg.w d0
+  move.w d0,(a1)+               | Entry 0x100 - i = -(entry i)
+  dbf d3,.gen_mirror
+
+.gen_wave_next:
+  add.w #(WaveTableSize * 2),a2
+  addq.w #0x1,d7
+  cmp.w #0x2,d7
+  bne .gen_wave
+
+  || Waveshaper, entry 0x0 and entries 0x81 to 0xFF stored, odd around entry 0x80
+  move.w GenShaperOffset(a3),d0
+  beq .gen_shaper_off
+  move.l a3,a0
+  add.w d0,a0
+  lea GenShaperLUT(a5),a1
+  move.w (a0)+,(a1)             | Entry 0x0 has no mirror image
+  add.w #ShaperTableSize,a1
+  move.l a1,ShaperLUT(a5)       | LUT points at the center entry
+  clr.w (a1)+
+  moveq.l #((ShaperTableSize / 2) - 2),d3
+.gen_shaper:
+  move.w (a0)+,(a1)+
+  dbf d3,.gen_shaper
+  move.l a1,a0
+  sub.w #(ShaperTableSize - 2),a0
+  sub.w #ShaperTableSize,a1
+  moveq.l #((ShaperTableSize / 2) - 2),d3
+.gen_shaper_mirror:
+  move.w (a0)+,d0
+  neg.w d0
+  move.w d0,-(a1)               | Entry 0x80 - i = -(entry 0x80 + i)
+  dbf d3,.gen_shaper_mirror
+.gen_shaper_off:
+
+  move.l a5,a0
+  bsr _synth_asm
+
+  || Right channel copy of the left, after the Haas delay
+  move.l GenRightOffset(a3),d0
+  beq .gen_done
+  lea (a4,d0.l),a1
+  move.l GenRightDelay(a3),d0
+  beq .gen_copy
+.gen_delay:
+  clr.b (a1)+
+  subq.l #0x1,d0
+  bne .gen_delay
+.gen_copy:
+  move.l GenRightLen(a3),d0
+  beq .gen_done
+.gen_copy_byte:
+  move.b (a4)+,(a1)+
+  subq.l #0x1,d0
+  bne .gen_copy_byte
+
+.gen_done:
+  movem.l (sp)+,d0-d7/a0-a6
   rts
 
-_synth_asm_sawtooth:
-  || Sawtooth oscillator
+_synth_asm:
+  movem.l d0-d7/a0-a6,-(sp)
+
+  move.l Samples(a0),a5
+  move.l Osc1Func(a0),a4
+  move.l Osc2Func(a0),a3
+  move.l FilterCoeffs(a0),a2
+  move.l AmpEnvLUT(a0),a1
+  move.l NumSamples(a0),d6
+  move.l Osc1PerInv(a0),d5      | 0x10000 / (oscillator 1 and 2 period) in two words
+  move.l EnvPhase(a0),d4
+  move.l ShaperLUT(a0),a6
+  clr.l Peak(a0)
+  clr.l QuantErr(a0)            | Clears QuantErr and QuantErrR
+
+  moveq.l #0x0,d7               | Sample number = 0
+  move.l d7,-(sp)               | Right filter state: x[n-1] = x[n-2] = 0
+  move.l d7,-(sp)               | Right filter state: y[n-1] = y[n-2] = 0
+  move.l d7,-(sp)               | Filter state: x[n-1] = x[n-2] = 0
+  move.l d7,-(sp)               | Filter state: y[n-1] = y[n-2] = 0
+
+  move.l #0x20,d7
+
+_synth_asm_dispatch:
+  tst.w DitherMask(a0)
+  bne .dither_on
+  move.l a6,d0
+  beq .shaper_off
+  LOOP_DISPATCH _shape
+.shaper_off:
+  LOOP_DISPATCH
+.dither_on:
+  move.l a6,d0
+  beq .dither_shaper_off
+  LOOP_DISPATCH _shape_dither
+.dither_shaper_off:
+  LOOP_DISPATCH _dither
+
+  || The loop set for each shaper and dither setting, see LOOP_SET.
+  LOOP_SET 0, 0
+  LOOP_SET 1, 0, _shape
+  LOOP_SET 0, 1, _dither
+  LOOP_SET 1, 1, _shape_dither
+
+_synth_asm_loops_end:
+  || Oscillators from here on each run up to the next, wave1/wave2/noise/sync/ring.
+_synth_asm_wave1:
+  || Oscillator 1 wavetable
   mulu.w d5,d0                  | (i * 0x10000) / osc_per
+_synth_asm_wave1_phase:
+  lsr.w #0x7,d0                 | Phase [0,0xFFFF] to table entry
+  and.w #((WaveTableSize - 1) * 2),d0
+  move.w OscWaves(a0,d0.w),d0
   rts
 
-_synth_asm_triangle:
-  || Triangle wave oscillator
+_synth_asm_wave2:
+  || Oscillator 2 wavetable
   mulu.w d5,d0                  | (i * 0x10000) / osc_per
-  move.w d0,d1
-  lsl.l #0x1,d0                 | (i * 0x10000) / osc_half_per
-  move.w #0xC000,d2             | Low dividend bit, high modulus bit for (/ osc_half_per)
-  and.w d2,d1
-  beq .done                     | Skip negation in phase 0-50%
-  eor.w d2,d1
-  beq .done                     | Skip negation in phase 150-200%
-  not.w d0                      | Negate (not.b to handle 0x8000) sawtooth in phase 50%-150%
-.done:
+_synth_asm_wave2_phase:
+  lsr.w #0x7,d0                 | Phase [0,0xFFFF] to table entry
+  and.w #((WaveTableSize - 1) * 2),d0
+  add.w #(WaveTableSize * 2),d0 | Oscillator 2 table follows oscillator 1
+  move.w OscWaves(a0,d0.w),d0
   rts
 
+_synth_asm_noise_phase:
+  || Noise oscillator ignores phase, steps with the sample index instead
+  move.l d7,d0
 _synth_asm_noise:
   || Noise oscillator
-  move.w d5,d1                  | 0x10000 / osc_per
-  lsl.l #0x1,d1                 | 0x10000 / osc_half_per
- 	mulu.w d1,d0                  | (i * 0x10000) / osc_half_per
-  sub.w d1,d0                   | ((i - 1) * 0x10000) / osc_half_per
-  bcs .prng                     | Update PRNG seed at beginning of each period
-  move.w 0xC(sp),d0             | Current PRNG seed
+  mulu.w d5,d0                  | (i * 0x10000) / osc_per
+  add.l d0,d0                   | (i * 0x10000) / osc_half_per
+  swap d0                       | Half periods elapsed
+  add.w d0,d0                   | Index words instead of bytes
+  and.w #((NoiseTableSize - 1) * 2),d0
+  move.l a1,-(sp)
+  move.l NoiseLUT(a0),a1        | New random value at the beginning of each half period
+  move.w (a1,d0.w),d0
+  move.l (sp)+,a1
   rts
 
-.prng:
- 	|| LFSR PRNG (http://codebase64.org/doku.php?id=base:small_fast_16-bit_prng)
-  move.w 0xC(sp),d0             | Current PRNG seed
-  beq .eor                      | Change zero seed to non-zero value
-  lsl.w #0x1,d0
-  beq .skip_eor                 | Change 0x8000 seed to zero
-  bcc .skip_eor                 | If carry zero XOR is no-op
-.eor:
-  eor.w #0xC2DF,d0              | XOR with magic
-.skip_eor:
-  move.w d0,0xC(sp)             | Update PRNG seed
+_synth_asm_sync:
+  || Oscillator 2 hard-synced to oscillator 1
+  swap d5                       | Oscillator 1 period to low word
+  mulu.w d5,d0                  | (i * 0x10000) / osc1_per
+  swap d5                       | Oscillator 2 period back to low word
+  mulu.w Osc1Per(a0),d0         | Oscillator 1 phase [0,0xFFFF] * osc1_per
+  clr.w d0
+  swap d0                       | i = samples since oscillator 1 phase reset
+  move.l Osc2CoupledFunc(a0),-(sp)
+  rts                           | Tail call to oscillator 2 generator
+
+_synth_asm_ring:
+  || Oscillator 2 ring modulated by oscillator 1
+  pea .ring_mod(pc)             | Return address for oscillator 2 generator
+  move.l Osc2CoupledFunc(a0),-(sp)
+  rts                           | Call oscillator 2 generator
+.ring_mod:
+  muls.w d3,d0                  | osc1 * osc2
+  swap d0
+  lsl.w #0x1,d0                 | signed FP rescale >> 15
   rts
+
+_synth_asm_end:
+
+  || Start of each loop in Loop order, one set per LoopVariant in the order the
+  || sets are assembled, then the end of the last loop. Each loop runs up to the next.
+_synth_asm_loop_blocks:
+  .long _synth_asm_sample_loop, _synth_asm_phase_loop, _synth_asm_stereo_loop
+  .long _synth_asm_stereo_phase_loop, _synth_asm_unison_loop
+  .long _synth_asm_sample_shape_loop, _synth_asm_phase_shape_loop, _synth_asm_stereo_shape_loop
+  .long _synth_asm_stereo_phase_shape_loop, _synth_asm_unison_shape_loop
+  .long _synth_asm_sample_dither_loop, _synth_asm_phase_dither_loop, _synth_asm_stereo_dither_loop
+  .long _synth_asm_stereo_phase_dither_loop, _synth_asm_unison_dither_loop
+  .long _synth_asm_sample_shape_dither_loop, _synth_asm_phase_shape_dither_loop
+  .long _synth_asm_stereo_shape_dither_loop, _synth_asm_stereo_phase_shape_dither_loop
+  .long _synth_asm_unison_shape_dither_loop
+  .long _synth_asm_loops_end
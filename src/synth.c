@@ -1,13 +1,32 @@
 #include "synth.h"
 
+#ifndef BEEP_HOST
+#include <devices/timer.h>
+#include <exec/execbase.h>
 #include <proto/exec.h>
+#include <proto/timer.h>
+#endif
+#include <stddef.h>
 #include <stdio.h>
 
+#ifndef BEEP_HOST
 #include <proto/dos.h> // FIXME
+#endif
 
 #define kSampleSizeAlignMask 0xFFF
+#define kMaxNumSamples 0x1FFFE // Paula length register counts 16-bit words
+#define kFirstSample 0x20 // initial sample number in synth_asm
 #define kFilterOrder 2
 #define kAmpEnvLUTSize 0x100
+#define kHaasMaxMs 30
+#define kLoopMinLen 0x40 // shortest loop, anything less buzzes at the loop rate
+#define kLoopMatchLen 0x10 // samples compared leading up to the loop points
+#define kLoopSearch 0x10 // loop starts tried either side of the period multiple
+#define kNormPeak 0x7F
+#define kGenBlocks 3 // prologue, loop, oscillators
+#define kGenWorkSize (sizeof(AsmParams) + ((kAmpEnvLUTSize + kShaperTableSize + kNoiseTableSize) * sizeof(WORD)))
+#define kEClockCPUDiv68000 10 // 7.09 MHz 68000 clock / E-clock
+#define kEClockCPUDiv68020 20 // 14.18 MHz 68020 clock / E-clock
 #define kFPUWordShift kBitsPerWord      // fixed-point unsigned WORDs << before divide >> after multiply
 #define kFPWordShift (kBitsPerWord - 1) // fixed-point   signed WORDs << before divide >> after multiply
 
@@ -21,51 +40,209 @@ typedef struct {
   APTR osc2_func;
   APTR filter_coeffs;
   APTR amp_env_lut;
-  UWORD num_samples;
   UWORD osc1_per_inv;
   UWORD osc2_per_inv;
-  UWORD num_samples_inv;
+  ULONG num_samples;
   UWORD osc1_amp_scale;
   UWORD osc2_amp_scale;
-  UWORD pad;
+  UWORD osc1_per;
+  UWORD osc2_sync;
+  APTR osc2_coupled_func;
+  APTR shaper_lut;
+  APTR unison_per_invs;
+  UWORD unison_shift;
+  UWORD unison_amp_scale;
+  ULONG osc1_phase;
+  ULONG osc2_phase;
+  ULONG osc1_phase_inc;
+  ULONG osc2_phase_inc;
+  APTR samples_right;
+  UWORD osc1_amp_scale_r;
+  UWORD osc2_amp_scale_r;
+  WORD stereo_oscs[2];
+  UWORD stereo_amp;
+  ULONG peak;
+  UWORD quant_err;
+  UWORD quant_err_r;
+  UWORD dither_mask;
+  ULONG env_phase;
+  ULONG env_phase_inc;
+  APTR noise_lut;
+  WORD osc_waves[2][kWaveTableSize];
 } AsmParams;
 
+// Generator patch, offsets in synth.asm.s. The AsmParams of the last render
+// follow up to the wavetables, then the tables the generator can't rebuild.
+typedef struct {
+  ULONG loop_start;
+  ULONG loop_end;
+  ULONG right_offset;
+  ULONG right_delay;
+  ULONG right_len;
+  UWORD amp_gain;
+  Envelope amp_env;
+  UWORD wave_offsets[2];
+  UBYTE wave_kinds[2];
+  UWORD shaper_offset;
+} GenPatch;
+
+// How a generator patch stores a wavetable. Band-limited waves are odd around
+// the middle entry, square and triangle also mirror within each half.
+typedef enum {
+  GenWave_None, GenWave_Custom, GenWave_Odd, GenWave_Quarter, kNumGenWaves
+} GenWave;
+
+typedef enum {
+  Loop_Sample, Loop_Phase, Loop_Stereo, Loop_StereoPhase, Loop_Unison, kNumLoops
+} Loop;
+
+// synth.asm.s has a set of kNumLoops loops per variant, the waveshaper and the
+// error feedback are only in the loops of the variants that use them.
+typedef enum {
+  LoopVariant_Plain, LoopVariant_Shape, LoopVariant_Dither, LoopVariant_ShapeDither, kNumLoopVariants
+} LoopVariant;
+
+typedef enum {
+  OscBlock_Wave1, OscBlock_Wave2, OscBlock_Noise, OscBlock_Sync, OscBlock_Ring, kNumOscBlocks
+} OscBlock;
+
 extern VOID synth_asm(/*__reg("a6") */AsmParams* asm_params);
-extern VOID* synth_asm_sawtooth;
-extern VOID* synth_asm_square;
-extern VOID* synth_asm_triangle;
+extern VOID* synth_asm_wave1;
+extern VOID* synth_asm_wave2;
 extern VOID* synth_asm_noise;
-
-static struct {
+extern VOID* synth_asm_wave1_phase;
+extern VOID* synth_asm_wave2_phase;
+extern VOID* synth_asm_noise_phase;
+extern VOID* synth_asm_sync;
+extern VOID* synth_asm_ring;
+extern VOID* synth_asm_gen;
+extern VOID* synth_asm_dispatch;
+extern VOID* synth_asm_loop_blocks[(kNumLoopVariants * kNumLoops) + 1];
+extern VOID* synth_asm_end;
+
+typedef VOID (*GenFunc)(/*__reg("a0") */APTR patch,
+                        /*__reg("a1") */BYTE* samples,
+                        /*__reg("a2") */APTR work);
+
+#ifdef BEEP_HOST
+// Portable C version of synth.asm.s, sharing AsmParams.
+#include "synth.host.c"
+#else
+struct Device* TimerBase;
+
+// Oscillator generators in the order synth.asm.s defines them, each runs up to the next.
+static VOID* OscBlocks[kNumOscBlocks + 1] = {
+  &synth_asm_wave1, &synth_asm_wave2, &synth_asm_noise_phase,
+  &synth_asm_sync, &synth_asm_ring, &synth_asm_end
+};
+
+// Bytes of each GenWave in a generator patch, the rest is rebuilt from them.
+static const UWORD GenWaveSizes[kNumGenWaves] = {
+  0, kCustomWavePoints, ((kWaveTableSize / 2) - 1) * sizeof(WORD), (kWaveTableSize / 4) * sizeof(WORD)
+};
+#endif
+
+// Render state of one client, see synth_create().
+struct Synth {
   AsmParams asm_params;
-  VOID* synth_funcs[kNumWaves];
   UWORD amp_env_lut[kAmpEnvLUTSize];
+  Envelope amp_env_lut_env;
+  UWORD amp_env_lut_gain;
   WORD filter_coeffs[2][1 + kFilterOrder];
-  UWORD samples_size_b;
+  UWORD filter_coeffs_rate_freq;
+  UWORD filter_coeffs_cutoff;
+  UWORD unison_per_invs[kMaxUnisonVoices + 1];
+  Wave waves[2];
+  BOOL right_copy;
+  ULONG right_delay;
+  ULONG loop_start;
+  ULONG loop_end;
+  BYTE* samples;
+  ULONG samples_size_b;
+  UBYTE* gen;
+  ULONG gen_size;
+  UBYTE* patch;
+  ULONG patch_size;
+};
+
+// Oscillator entry points, only written by synth_init().
+static struct {
+  VOID* synth_funcs[2][kNumWaves];
+  VOID* phase_funcs[2][kNumWaves];
+  VOID* couple_funcs[kNumCouples];
 } g;
 
 BOOL synth_init() {
-  printf("synth_asm: %p\n", synth_asm);
+  // Each oscillator reads its own copy of the selected wavetable.
+  for (Wave wave = 0; wave < kNumWaves; ++ wave) {
+    g.synth_funcs[0][wave] = &synth_asm_wave1;
+    g.synth_funcs[1][wave] = &synth_asm_wave2;
+    g.phase_funcs[0][wave] = &synth_asm_wave1_phase;
+    g.phase_funcs[1][wave] = &synth_asm_wave2_phase;
+  }
 
-  g.synth_funcs[Wave_Square] = &synth_asm_square;
-  g.synth_funcs[Wave_Sawtooth] = &synth_asm_sawtooth;
-  g.synth_funcs[Wave_Triangle] = &synth_asm_triangle;
-  g.synth_funcs[Wave_Noise] = &synth_asm_noise;
+  for (UWORD osc = 0; osc < 2; ++ osc) {
+    g.synth_funcs[osc][Wave_Noise] = &synth_asm_noise;
+    g.phase_funcs[osc][Wave_Noise] = &synth_asm_noise_phase;
+  }
 
-  g.asm_params.filter_coeffs = (WORD*)g.filter_coeffs;
-  g.asm_params.amp_env_lut = g.amp_env_lut;
+  // Coupled modes wrap oscillator 2, plain mix calls it directly.
+  g.couple_funcs[Couple_Mix] = NULL;
+  g.couple_funcs[Couple_Sync] = &synth_asm_sync;
+  g.couple_funcs[Couple_Ring] = &synth_asm_ring;
 
   return TRUE;
 }
 
-VOID synth_fini() {
-  if (g.asm_params.samples) {
-    FreeMem(g.asm_params.samples, g.samples_size_b);
+Synth* synth_create() {
+  Synth* synth = (Synth*)AllocMem(sizeof(Synth), MEMF_CLEAR);
+
+  if (synth) {
+    synth->asm_params.filter_coeffs = (WORD*)synth->filter_coeffs;
+    synth->asm_params.amp_env_lut = synth->amp_env_lut;
+    synth->asm_params.noise_lut = NoiseTable;
+  }
+
+  return synth;
+}
+
+static VOID free_generator(Synth* synth) {
+  if (synth->gen) {
+    FreeMem(synth->gen, synth->gen_size);
+    synth->gen = NULL;
   }
+
+  if (synth->patch) {
+    FreeMem(synth->patch, synth->patch_size);
+    synth->patch = NULL;
+  }
+}
+
+VOID synth_delete(Synth* synth) {
+  free_generator(synth);
+
+  if (synth->samples) {
+    FreeMem(synth->samples, synth->samples_size_b);
+  }
+
+  FreeMem(synth, sizeof(Synth));
 }
 
-static VOID make_amp_env_lut(Envelope* amp_env,
+// Only regenerated when the envelope or gain change, e.g. not between keymap notes.
+static VOID make_amp_env_lut(Synth* synth,
+                             Envelope* amp_env,
                              UWORD gain) {
+  if (gain == synth->amp_env_lut_gain &&
+      amp_env->attack == synth->amp_env_lut_env.attack &&
+      amp_env->decay == synth->amp_env_lut_env.decay &&
+      amp_env->sustain == synth->amp_env_lut_env.sustain &&
+      amp_env->release == synth->amp_env_lut_env.release) {
+    return;
+  }
+
+  synth->amp_env_lut_env = *amp_env;
+  synth->amp_env_lut_gain = gain;
+
   UBYTE attack_end = amp_env->attack;
   UBYTE decay_end = attack_end + amp_env->decay;
   UBYTE sustain_end = kUByteMax - amp_env->release;
@@ -86,7 +263,7 @@ static VOID make_amp_env_lut(Envelope* amp_env,
       amp = amp_env->sustain - ((amp_env->sustain * (i - sustain_end)) / amp_env->release);
     }
 
-    g.amp_env_lut[i] = MIN(kUWordMax, (amp * gain) >> 8);
+    synth->amp_env_lut[i] = MIN(kWordMax, (amp * gain) >> 8);
   }
 }
 
@@ -121,8 +298,17 @@ static Complex complex_asr(Complex a,
   return (Complex){ a.v[0] >> shift, a.v[1] >> shift };
 }
 
-static VOID make_filter_coeffs(UWORD rate_freq,
+// Only recalculated when the sample rate or cutoff change.
+static VOID make_filter_coeffs(Synth* synth,
+                               UWORD rate_freq,
                                UWORD cutoff) {
+  if (rate_freq == synth->filter_coeffs_rate_freq && cutoff == synth->filter_coeffs_cutoff) {
+    return;
+  }
+
+  synth->filter_coeffs_rate_freq = rate_freq;
+  synth->filter_coeffs_cutoff = cutoff;
+
   // Butterworth lowpass filter math summarized at: https://www.dsprelated.com/showarticle/1119.php
 
   // Clamp cutoff to 1/4 sample rate for tan lookup.
@@ -225,9 +411,9 @@ static VOID make_filter_coeffs(UWORD rate_freq,
   //                - y[n-1]*a1 - y[n-2]*a2 - ... - y[0]*aN
   //
   // Division by coeffs_a[kFilterOrder].real optimized away (always 1).
-  for (UWORD i = 0; i < ARRAY_SIZE(g.filter_coeffs[0]); ++ i) {
-    g.filter_coeffs[0][i] = coeffs_b[i];
-    g.filter_coeffs[1][i] = - coeffs_a[i].v[0];
+  for (UWORD i = 0; i < ARRAY_SIZE(synth->filter_coeffs[0]); ++ i) {
+    synth->filter_coeffs[0][i] = coeffs_b[i];
+    synth->filter_coeffs[1][i] = - coeffs_a[i].v[0];
   }
 
   // Scale transfer function H(z) numerator to normalize gain at 0Hz.
@@ -235,98 +421,649 @@ static VOID make_filter_coeffs(UWORD rate_freq,
   WORD scale_numer = 0;
   WORD scale_denom = 0;
 
-  for (UWORD i = 0; i < ARRAY_SIZE(g.filter_coeffs[0]); ++ i) {
-    scale_numer += g.filter_coeffs[1][i];
-    scale_denom += g.filter_coeffs[0][i];
+  for (UWORD i = 0; i < ARRAY_SIZE(synth->filter_coeffs[0]); ++ i) {
+    scale_numer += synth->filter_coeffs[1][i];
+    scale_denom += synth->filter_coeffs[0][i];
   }
 
   UWORD scale = abs(scale_numer / scale_denom);
 
   scale = (scale * 26213) >> 16;
 
-  for (UWORD i = 0; i < ARRAY_SIZE(g.filter_coeffs[0]); ++ i) {
-    g.filter_coeffs[0][i] *= scale;
-    //printf("recur[%u]: (%ld, %ld)\n", i, g.filter_coeffs[0][i], g.filter_coeffs[1][i]);
+  for (UWORD i = 0; i < ARRAY_SIZE(synth->filter_coeffs[0]); ++ i) {
+    synth->filter_coeffs[0][i] *= scale;
+    //printf("recur[%u]: (%ld, %ld)\n", i, synth->filter_coeffs[0][i], synth->filter_coeffs[1][i]);
+  }
+}
+
+// Copy the wavetable mip level band-limited for the oscillator period.
+// The custom wave is linearly interpolated between its points instead.
+static VOID load_wave_table(Synth* synth,
+                            UWORD osc,
+                            Wave wave,
+                            BYTE* custom_wave,
+                            UWORD osc_per) {
+  synth->waves[osc] = wave;
+
+  if (wave == Wave_Noise) {
+    return;
+  }
+
+  if (wave == Wave_Custom) {
+    UWORD point_stride = kWaveTableSize / kCustomWavePoints;
+
+    for (UWORD i = 0; i < kWaveTableSize; ++ i) {
+      UWORD point = i / point_stride;
+      UWORD frac = i % point_stride;
+      WORD from = custom_wave[point];
+      WORD to = custom_wave[(point + 1) % kCustomWavePoints];
+
+      // Point range [-0x80,0x7F] to table range [-0x8000,0x7F00].
+      synth->asm_params.osc_waves[osc][i] =
+        ((from * (point_stride - frac)) + (to * frac)) * (0x100 / point_stride);
+    }
+
+    return;
+  }
+
+  UWORD mip_level = 0;
+
+  while (mip_level < (kWaveMipLevels - 1) && osc_per < (kWaveTableSize >> mip_level)) {
+    ++ mip_level;
+  }
+
+  CopyMem(wave_table_lookup(wave, mip_level), synth->asm_params.osc_waves[osc], sizeof(synth->asm_params.osc_waves[osc]));
+}
+
+// 0x100000000 / (oscillator period) for phase accumulation, osc_freq in 16.16 fixed-point Hz.
+static ULONG phase_inc(UWORD rate_freq,
+                       ULONG osc_freq) {
+  ULONG whole = osc_freq / rate_freq;
+  ULONG frac = ((osc_freq % rate_freq) << kFPUWordShift) / rate_freq;
+
+  return (whole << kFPUWordShift) + frac;
+}
+
+// Discontinuity of jumping from end back to start, i.e. how much the samples
+// leading up to start differ from those leading up to end.
+static ULONG loop_cost(BYTE* samples,
+                       BYTE* samples_right,
+                       ULONG start,
+                       ULONG end) {
+  ULONG cost = 0;
+
+  for (UWORD i = 0; i < kLoopMatchLen; ++ i) {
+    cost += ABS(samples[start - i] - samples[end - i]);
+
+    if (samples_right) {
+      cost += ABS(samples_right[start - i] - samples_right[end - i]);
+    }
+  }
+
+  return cost;
+}
+
+// Find a loop that repeats the tail of the sample without clicking.
+// The loop ends on the rising zero crossing nearest the end of the sample and
+// its length is the multiple of osc1_per closest to a multiple of osc2_per,
+// so both oscillators complete whole cycles. The start is then refined to the
+// nearby position whose waveform best matches the end.
+// Loop points are even so the one-shot and repeat parts can be played by Paula.
+// num_samples counts only the samples the kernel wrote.
+static VOID find_loop(BYTE* samples,
+                      BYTE* samples_right,
+                      ULONG num_samples,
+                      UWORD osc1_per,
+                      UWORD osc2_per,
+                      ULONG* out_loop_start,
+                      ULONG* out_loop_end) {
+  ULONG min_start = kFirstSample + kLoopMatchLen + kLoopSearch;
+  ULONG end = num_samples - 2;
+  ULONG best_end = end;
+  UWORD best_zero = kUWordMax;
+
+  *out_loop_start = num_samples;
+  *out_loop_end = num_samples;
+
+  for (; end > min_start && end + (2 * osc1_per) > num_samples; end -= 2) {
+    if (samples[end] >= samples[end - 1]) {
+      UWORD zero = ABS(samples[end]) + (samples_right ? ABS(samples_right[end]) : 0);
+
+      if (zero < best_zero) {
+        best_zero = zero;
+        best_end = end;
+      }
+    }
+  }
+
+  end = best_end;
+
+  if (end < min_start + kLoopMinLen) {
+    return;
+  }
+
+  // Walk multiples of osc1_per tracking the distance to the nearest multiple of osc2_per.
+  ULONG max_len = end - min_start;
+  ULONG loop_len = 0;
+  UWORD best_dist = kUWordMax;
+  UWORD rem = 0;
+
+  for (ULONG len = osc1_per; len <= max_len; len += osc1_per) {
+    rem += osc1_per;
+
+    while (rem >= osc2_per) {
+      rem -= osc2_per;
+    }
+
+    UWORD dist = MIN(rem, osc2_per - rem);
+
+    if (len >= kLoopMinLen && dist < best_dist) {
+      best_dist = dist;
+      loop_len = len;
+
+      if (dist == 0) {
+        break;
+      }
+    }
+  }
+
+  if (! loop_len) {
+    return;
+  }
+
+  ULONG center = (end - loop_len) & ~1UL;
+  ULONG start = MAX(min_start, center - kLoopSearch) & ~1UL;
+  ULONG last_start = MIN(end - kLoopMinLen, center + kLoopSearch);
+  ULONG best_start = center;
+  ULONG best_cost = 0xFFFFFFFF;
+
+  for (; start <= last_start; start += 2) {
+    ULONG cost = loop_cost(samples, samples_right, start, end);
+
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_start = start;
+    }
+  }
+
+  *out_loop_start = best_start;
+  *out_loop_end = end;
+}
+
+// Paula plays at most kMaxNumSamples bytes per channel; longer notes are truncated.
+ULONG synth_num_samples(UWORD rate_freq,
+                        UWORD duration_ms) {
+  return MAX(kMinNumSamples, MIN(kMaxNumSamples, DIV_ROUND_NEAREST((ULONG)rate_freq * duration_ms, 1000) & ~1UL));
+}
+
+VOID synth_render(Synth* synth,
+                  Wave osc1_wave,
+                    Wave osc2_wave,
+                  BYTE* custom_wave,
+                  UWORD osc_mix,
+                  Couple osc_couple,
+                  UWORD rate_freq,
+                  ULONG osc1_freq,
+                  ULONG osc2_freq,
+                  BOOL fine_tune,
+                  UWORD unison_voices,
+                  UWORD unison_spread,
+                  UWORD duration_ms,
+                  UWORD cutoff,
+                  Shape shape,
+                  UWORD gain,
+                  BOOL normalize,
+                  BOOL dither,
+                  Stereo stereo,
+                  UWORD stereo_width,
+                  Envelope* amp_env,
+                  BYTE* samples,
+                  BYTE* samples_right,
+                  ULONG* out_num_samples,
+                  ULONG* out_loop_start) {
+  synth->asm_params.samples = samples;
+  synth->asm_params.num_samples = synth_num_samples(rate_freq, duration_ms);
+
+  // Generate amplitude envelope lookup table.
+  make_amp_env_lut(synth, amp_env, gain);
+
+  // Calculate lowpass filter coefficients.
+  make_filter_coeffs(synth, rate_freq, cutoff);
+
+  // Select waveshaper curve, bypassed entirely when off.
+  synth->asm_params.shaper_lut = shaper_lookup(shape);
+
+  // Error feedback keeps the fraction truncated from each output byte for the next,
+  // only the loops synth_asm picks when the mask is set have it.
+  synth->asm_params.dither_mask = dither ? kUWordMax : 0;
+
+  // Quantize oscillator period for the current sample rate.
+  // A fractional period would cause variation in waveform repetition,
+  // creating audible low-frequency harmonics.
+  UWORD osc1_per = MAX(1, DIV_ROUND_NEAREST((ULONG)rate_freq << kFPUWordShift, osc1_freq));
+  UWORD osc2_per = MAX(1, DIV_ROUND_NEAREST((ULONG)rate_freq << kFPUWordShift, osc2_freq));
+
+  // Calculate 1/osc_per.
+  // Quantize close to 0x10000 to again minimize low-frequency harmonics.
+  synth->asm_params.osc1_per_inv = DIV_ROUND_NEAREST(1 << kFPUWordShift, osc1_per);
+  synth->asm_params.osc2_per_inv = DIV_ROUND_NEAREST(1 << kFPUWordShift, osc2_per);
+
+  // Fine tuning trades whole-sample periods for exact pitch.
+  // Phase accumulation replaces the per-sample multiply.
+  synth->asm_params.osc1_phase = 0;
+  synth->asm_params.osc2_phase = 0;
+  synth->asm_params.osc1_phase_inc = 0;
+  synth->asm_params.osc2_sync = FALSE;
+
+  if (fine_tune) {
+    synth->asm_params.osc1_phase_inc = phase_inc(rate_freq, osc1_freq);
+    synth->asm_params.osc2_phase_inc = phase_inc(rate_freq, osc2_freq);
+
+    // Noise generator steps with the sample index, reading the upper word of the increment as 1/osc_per.
+    synth->asm_params.osc1_per_inv = synth->asm_params.osc1_phase_inc >> kFPUWordShift;
+    synth->asm_params.osc2_per_inv = synth->asm_params.osc2_phase_inc >> kFPUWordShift;
+  }
+
+  // Calculate 1/num_samples for amplitude envelope table lookup.
+  // The kernel accumulates it per sample instead of multiplying by a 32-bit sample number.
+  synth->asm_params.env_phase_inc = 0xFFFFFFFF / synth->asm_params.num_samples;
+  synth->asm_params.env_phase = (kFirstSample - 1) * synth->asm_params.env_phase_inc;
+
+  /* synth->filter_coeffs[0][2] = 129; */
+  /* synth->filter_coeffs[0][1] = 259; */
+  /* synth->filter_coeffs[0][0] = 129; */
+  /* synth->filter_coeffs[1][1] = 28398; */
+  /* synth->filter_coeffs[1][0] = -12532; */
+  /* printf("osc1_freq: %u\n", osc1_freq); */
+  /* printf("osc1_per: %u\n", osc1_per); */
+
+  /* printf("coeff b0: %ld\n", synth->filter_coeffs[0][2]); */
+  /* printf("coeff b1: %ld\n", synth->filter_coeffs[0][1]); */
+  /* printf("coeff b2: %ld\n", synth->filter_coeffs[0][0]); */
+  /* printf("coeff a1: %ld\n", synth->filter_coeffs[1][1]); */
+  /* printf("coeff a2: %ld\n", synth->filter_coeffs[1][0]); */
+  /* printf("samples: %p\n", synth->asm_params.samples); */
+
+  synth->asm_params.osc1_per = osc1_per;
+  synth->asm_params.osc1_func = (fine_tune ? g.phase_funcs : g.synth_funcs)[0][osc1_wave];
+  synth->asm_params.osc2_func = (fine_tune ? g.phase_funcs : g.synth_funcs)[1][osc2_wave];
+  load_wave_table(synth, 0, osc1_wave, custom_wave, osc1_per);
+  load_wave_table(synth, 1, osc2_wave, custom_wave, osc2_per);
+
+  if (fine_tune && osc_couple == Couple_Sync) {
+    // Phase accumulator loop resets oscillator 2 itself.
+    synth->asm_params.osc2_sync = TRUE;
+  }
+  else if (g.couple_funcs[osc_couple]) {
+    // Route oscillator 2 through the coupling wrapper, which calls the wave generator.
+    synth->asm_params.osc2_coupled_func = synth->asm_params.osc2_func;
+    synth->asm_params.osc2_func = g.couple_funcs[osc_couple];
+  }
+
+  synth->asm_params.osc1_amp_scale = (kWordMax * (100 - osc_mix)) / 100;
+  synth->asm_params.osc2_amp_scale = kWordMax - synth->asm_params.osc1_amp_scale;
+
+  // Unison replaces both oscillators with voices of oscillator 1 spread over
+  // [-unison_spread/2, unison_spread/2] cents, summed and scaled by 1/voices.
+  synth->asm_params.unison_per_invs = NULL;
+
+  if (unison_voices > 1) {
+    ULONG center_per_inv = osc1_freq / rate_freq;
+
+    for (UWORD voice = 0; voice < unison_voices; ++ voice) {
+      WORD cents = DIV_ROUND_NEAREST(((WORD)(2 * voice) - (WORD)(unison_voices - 1)) * (WORD)unison_spread,
+                                     (WORD)(2 * (unison_voices - 1)));
+
+      // Fractional period, quantizing to whole samples would swamp the spread.
+      ULONG voice_per_inv = (center_per_inv * cent_scale_lookup(cents)) >> kFPWordShift;
+      synth->unison_per_invs[voice] = MIN(kUWordMax, voice_per_inv);
+    }
+
+    synth->unison_per_invs[unison_voices] = 0;
+    synth->asm_params.unison_per_invs = synth->unison_per_invs;
+    synth->asm_params.osc1_func = g.synth_funcs[0][osc1_wave];
+    synth->asm_params.unison_shift = log2_ceil(unison_voices);
+    synth->asm_params.unison_amp_scale = (((kWordMax + 1) / 2) << synth->asm_params.unison_shift) / unison_voices;
   }
+
+  // Pan renders both channels in one pass, sharing oscillators and envelope.
+  // Oscillator 1 moves left and oscillator 2 right as the width increases.
+  synth->asm_params.samples_right = NULL;
+
+  if (stereo == Stereo_Pan && ! synth->asm_params.unison_per_invs) {
+    synth->asm_params.samples_right = samples_right;
+    synth->asm_params.osc1_amp_scale_r = (synth->asm_params.osc1_amp_scale * (100 - stereo_width)) / 100;
+    synth->asm_params.osc2_amp_scale_r = synth->asm_params.osc2_amp_scale;
+    synth->asm_params.osc2_amp_scale = (synth->asm_params.osc2_amp_scale * (100 - stereo_width)) / 100;
+  }
+
+  synth_asm(&synth->asm_params);
+
+  // Normalize renders again with the exact gain that puts the tracked
+  // pre-clamp peak at full scale, using the whole 8-bit range without clipping.
+  // The gain is capped at kWordMax as the kernel applies it with a signed multiply.
+  if (normalize && synth->asm_params.peak) {
+    ULONG norm_scale = ((ULONG)kNormPeak << (kBitsPerWord + kBitsPerByte)) / synth->asm_params.peak;
+    make_amp_env_lut(synth, amp_env, MIN(kWordMax, ((ULONG)gain * MIN(kUWordMax, norm_scale)) >> kBitsPerByte));
+
+    synth->asm_params.osc1_phase = 0;
+    synth->asm_params.osc2_phase = 0;
+    synth_asm(&synth->asm_params);
+  }
+
+  // The kernel starts at sample number kFirstSample but writes from the start
+  // of the buffer, so the last kFirstSample bytes are never written.
+  ULONG num_written = synth->asm_params.num_samples - kFirstSample;
+
+  // Otherwise the right channel is a copy of the left, delayed in Haas mode
+  // by up to kHaasMaxMs so the precedence effect widens the image.
+  synth->right_copy = (samples_right && ! synth->asm_params.samples_right);
+  synth->right_delay = 0;
+
+  if (synth->right_copy) {
+    ULONG delay = 0;
+
+    if (stereo == Stereo_Haas) {
+      delay = MIN(num_written, ((ULONG)rate_freq * kHaasMaxMs * stereo_width) / (1000 * 100));
+    }
+
+    for (UWORD i = 0; i < delay; ++ i) {
+      samples_right[i] = 0;
+    }
+
+    CopyMem(synth->asm_params.samples, samples_right + delay, num_written - delay);
+    synth->right_delay = delay;
+  }
+
+  // The sample is cut at the loop end, dropping less than a period from the tail.
+  find_loop(synth->asm_params.samples, samples_right, num_written,
+            osc1_per, osc2_per, out_loop_start, out_num_samples);
+  synth->loop_start = *out_loop_start;
+  synth->loop_end = *out_num_samples;
 }
 
-BOOL synth_generate(Wave osc1_wave,
+BOOL synth_generate(Synth* synth,
+                    Wave osc1_wave,
                     Wave osc2_wave,
+                    BYTE* custom_wave,
                     UWORD osc_mix,
+                    Couple osc_couple,
                     UWORD rate_freq,
-                    UWORD osc1_freq,
-                    UWORD osc2_freq,
+                    ULONG osc1_freq,
+                    ULONG osc2_freq,
+                    BOOL fine_tune,
+                    UWORD unison_voices,
+                    UWORD unison_spread,
                     UWORD duration_ms,
                     UWORD cutoff,
+                    Shape shape,
                     UWORD gain,
+                    BOOL normalize,
+                    BOOL dither,
+                    Stereo stereo,
+                    UWORD stereo_width,
                     Envelope* amp_env,
                     BYTE** out_samples,
-                    UWORD* out_num_samples) {
+                    BYTE** out_samples_right,
+                    ULONG* out_num_samples,
+                    ULONG* out_loop_start) {
   BOOL ret = TRUE;
 
-  // FIXME: document range restriction.
-  g.asm_params.num_samples = MAX(0x100, MIN(kWordMax, DIV_ROUND_NEAREST(rate_freq * duration_ms, 1000) & ~1UL));
-
   // Allocate sample memory in chunks to minimize fragmentation.
-  ULONG samples_size_b = (g.asm_params.num_samples + kSampleSizeAlignMask) & ~kSampleSizeAlignMask;
+  // Stereo keeps the right channel in the same allocation, after the left.
+  ULONG chan_size_b = (synth_num_samples(rate_freq, duration_ms) + kSampleSizeAlignMask) & ~kSampleSizeAlignMask;
+  ULONG samples_size_b = (stereo == Stereo_Off) ? chan_size_b : (2 * chan_size_b);
 
-  if (g.samples_size_b != samples_size_b) {
-    if (g.asm_params.samples) {
-      FreeMem(g.asm_params.samples, g.samples_size_b);
+  if (synth->samples_size_b != samples_size_b) {
+    if (synth->samples) {
+      FreeMem(synth->samples, synth->samples_size_b);
     }
 
-    g.samples_size_b = samples_size_b;
-    CHECK(g.asm_params.samples = (BYTE*)AllocMem(g.samples_size_b, MEMF_CHIP));
+    synth->samples_size_b = samples_size_b;
+    CHECK(synth->samples = (BYTE*)AllocMem(synth->samples_size_b, MEMF_CHIP));
   }
 
-  // Generat amplitude envelope lookup table.
-  // FIXME: if needed
-  make_amp_env_lut(amp_env, gain);
+  BYTE* samples_right = (stereo == Stereo_Off) ? NULL : synth->samples + chan_size_b;
 
-  // Calculate lowpass filter coefficients.
-  // FIXME: if needed
-  make_filter_coeffs(rate_freq, cutoff);
+  synth_render(synth, osc1_wave, osc2_wave, custom_wave, osc_mix, osc_couple, rate_freq, osc1_freq, osc2_freq,
+               fine_tune, unison_voices, unison_spread, duration_ms, cutoff, shape, gain, normalize, dither,
+               stereo, stereo_width, amp_env, synth->samples, samples_right, out_num_samples, out_loop_start);
 
-  // Quantize oscillator period for the current sample rate.
-  // A fractional period would cause variation in waveform repetition,
-  // creating audible low-frequency harmonics.
-  UWORD osc1_per = DIV_ROUND_NEAREST(rate_freq, osc1_freq);
-  UWORD osc2_per = DIV_ROUND_NEAREST(rate_freq, osc2_freq);
+  *out_samples = synth->samples;
+  *out_samples_right = samples_right;
 
-  // Calculate 1/osc_per.
-  // Quantize close to 0x10000 to again minimize low-frequency harmonics.
-  g.asm_params.osc1_per_inv = DIV_ROUND_NEAREST(1 << kFPUWordShift, osc1_per);
-  g.asm_params.osc2_per_inv = DIV_ROUND_NEAREST(1 << kFPUWordShift, osc2_per);
+cleanup:
+  return ret;
+}
 
-  // Calculate 0x100/num_samples for amplitude envelope table lookup.
-  g.asm_params.num_samples_inv = (0x100 << kFPUWordShift) / g.asm_params.num_samples;
+#ifndef BEEP_HOST
+static OscBlock osc_block(APTR func) {
+  OscBlock block = 0;
 
-  /* g.filter_coeffs[0][2] = 129; */
-  /* g.filter_coeffs[0][1] = 259; */
-  /* g.filter_coeffs[0][0] = 129; */
-  /* g.filter_coeffs[1][1] = 28398; */
-  /* g.filter_coeffs[1][0] = -12532; */
-  /* printf("osc1_freq: %u\n", osc1_freq); */
-  /* printf("osc1_per: %u\n", osc1_per); */
+  while ((UBYTE*)func >= (UBYTE*)OscBlocks[block + 1]) {
+    ++ block;
+  }
+
+  return block;
+}
+
+// Render the patch with the generator on a copy, timed by the E-clock.
+// CPU cycles assume a stock 68000 or 68020 machine.
+static ULONG time_generator(Synth* synth) {
+  ULONG cycles = 0;
+  struct timerequest timer_io = { 0 };
+  BYTE* samples = NULL;
+  APTR work = NULL;
+  ULONG samples_size_b = 2 * synth->asm_params.num_samples;
+
+  if (OpenDevice(TIMERNAME, UNIT_ECLOCK, (struct IORequest*)&timer_io, 0) != 0) {
+    return 0;
+  }
+
+  TimerBase = timer_io.tr_node.io_Device;
 
-  /* printf("coeff b0: %ld\n", g.filter_coeffs[0][2]); */
-  /* printf("coeff b1: %ld\n", g.filter_coeffs[0][1]); */
-  /* printf("coeff b2: %ld\n", g.filter_coeffs[0][0]); */
-  /* printf("coeff a1: %ld\n", g.filter_coeffs[1][1]); */
-  /* printf("coeff a2: %ld\n", g.filter_coeffs[1][0]); */
-  /* printf("samples: %p\n", g.asm_params.samples); */
+  if ((samples = (BYTE*)AllocMem(samples_size_b, 0)) &&
+      (work = AllocMem(kGenWorkSize, 0))) {
+    struct EClockVal start;
+    struct EClockVal end;
 
-  g.asm_params.osc1_func = g.synth_funcs[osc1_wave];
-  g.asm_params.osc2_func = g.synth_funcs[osc2_wave];
+    ReadEClock(&start);
+    ((GenFunc)synth->gen)(synth->patch, samples, work);
+    ReadEClock(&end);
 
-  g.asm_params.osc1_amp_scale = (kWordMax * (100 - osc_mix)) / 100;
-  g.asm_params.osc2_amp_scale = kWordMax - g.asm_params.osc1_amp_scale;
+    UWORD cpu_div = (SysBase->AttnFlags & AFF_68020) ? kEClockCPUDiv68020 : kEClockCPUDiv68000;
+    cycles = (end.ev_lo - start.ev_lo) * cpu_div;
+  }
+
+  if (work) {
+    FreeMem(work, kGenWorkSize);
+  }
+
+  if (samples) {
+    FreeMem(samples, samples_size_b);
+  }
+
+  CloseDevice((struct IORequest*)&timer_io);
+
+  return cycles;
+}
+
+BOOL synth_make_generator(Synth* synth,
+                          APTR* out_gen,
+                          ULONG* out_gen_size,
+                          APTR* out_patch,
+                          ULONG* out_patch_size,
+                          ULONG* out_work_size,
+                          ULONG* out_render_cycles) {
+  BOOL ret = TRUE;
+  AsmParams* params = &synth->asm_params;
+
+  free_generator(synth);
+
+  // Same loop synth_asm dispatches to for these parameters.
+  Loop loop =
+    params->unison_per_invs ? Loop_Unison :
+    params->samples_right ? (params->osc1_phase_inc ? Loop_StereoPhase : Loop_Stereo) :
+    (params->osc1_phase_inc ? Loop_Phase : Loop_Sample);
+  LoopVariant variant = (params->shaper_lut ? LoopVariant_Shape : LoopVariant_Plain) +
+                        (params->dither_mask ? LoopVariant_Dither : LoopVariant_Plain);
+  UWORD loop_block = (variant * kNumLoops) + loop;
 
-  synth_asm(&g.asm_params);
+  // Oscillators called by the loop, unison voices only run oscillator 1.
+  BOOL osc_used[kNumOscBlocks] = { FALSE };
+  OscBlock osc1_block = osc_block(params->osc1_func);
+  OscBlock osc2_block = osc_block(params->osc2_func);
+  BOOL coupled = (! params->unison_per_invs && (osc2_block == OscBlock_Sync || osc2_block == OscBlock_Ring));
 
-  *out_samples = g.asm_params.samples;
-  *out_num_samples = g.asm_params.num_samples;
+  osc_used[osc1_block] = TRUE;
+
+  if (! params->unison_per_invs) {
+    osc_used[osc2_block] = TRUE;
+  }
+
+  if (coupled) {
+    osc_used[osc_block(params->osc2_coupled_func)] = TRUE;
+  }
+
+  // Generator is the relocating entry and prologue, the loop, then the oscillators.
+  UBYTE* block_starts[kGenBlocks + kNumOscBlocks] = {
+    (UBYTE*)&synth_asm_gen, (UBYTE*)synth_asm_loop_blocks[loop_block]
+  };
+  UBYTE* block_ends[kGenBlocks + kNumOscBlocks] = {
+    (UBYTE*)&synth_asm_dispatch, (UBYTE*)synth_asm_loop_blocks[loop_block + 1]
+  };
+  ULONG osc_offsets[kNumOscBlocks];
+  UWORD num_blocks = 2;
+
+  synth->gen_size = (block_ends[0] - block_starts[0]) + (block_ends[1] - block_starts[1]);
+
+  for (OscBlock block = 0; block < kNumOscBlocks; ++ block) {
+    if (osc_used[block]) {
+      osc_offsets[block] = synth->gen_size;
+      block_starts[num_blocks] = (UBYTE*)OscBlocks[block];
+      block_ends[num_blocks] = (UBYTE*)OscBlocks[block + 1];
+      synth->gen_size += block_ends[num_blocks] - block_starts[num_blocks];
+      ++ num_blocks;
+    }
+  }
+
+  CHECK(synth->gen = (UBYTE*)AllocMem(synth->gen_size, 0));
+
+  ULONG gen_offset = 0;
+
+  for (UWORD block = 0; block < num_blocks; ++ block) {
+    CopyMem(block_starts[block], synth->gen + gen_offset, block_ends[block] - block_starts[block]);
+    gen_offset += block_ends[block] - block_starts[block];
+  }
+
+  // Patch is a GenPatch, the AsmParams of the last render without the wavetables
+  // and the tables the generator can't rebuild, with pointers turned into offsets
+  // from the generator, patch or sample buffer. The envelope LUT and noise are
+  // rebuilt whole, wavetables and the shaper from the entries symmetry can't give.
+  ULONG params_offset = sizeof(GenPatch);
+  ULONG filter_offset = params_offset + offsetof(AsmParams, osc_waves);
+  ULONG unison_offset = filter_offset + sizeof(synth->filter_coeffs);
+  ULONG shaper_offset = unison_offset + (params->unison_per_invs ? sizeof(synth->unison_per_invs) : 0);
+  GenWave wave_kinds[2];
+  ULONG wave_offsets[2];
+
+  for (UWORD osc = 0; osc < 2; ++ osc) {
+    Wave wave = synth->waves[osc];
+
+    wave_kinds[osc] =
+      ((osc == 1 && params->unison_per_invs) || wave == Wave_Noise) ? GenWave_None :
+      (wave == Wave_Custom) ? GenWave_Custom :
+      (wave == Wave_Sawtooth) ? GenWave_Odd : GenWave_Quarter;
+    wave_offsets[osc] = wave_kinds[osc] ? shaper_offset : 0;
+    shaper_offset += GenWaveSizes[wave_kinds[osc]];
+  }
+
+  synth->patch_size = shaper_offset + (params->shaper_lut ? ((kShaperTableSize / 2) * sizeof(WORD)) : 0);
+  CHECK(synth->patch = (UBYTE*)AllocMem(synth->patch_size, 0));
+
+  GenPatch* header = (GenPatch*)synth->patch;
+  header->loop_start = synth->loop_start;
+  header->loop_end = synth->loop_end;
+  header->right_offset = synth->right_copy ? params->num_samples : 0;
+  header->right_delay = synth->right_delay;
+  header->right_len = (params->num_samples - kFirstSample) - synth->right_delay;
+  header->amp_gain = synth->amp_env_lut_gain;
+  header->amp_env = synth->amp_env_lut_env;
+  header->shaper_offset = params->shaper_lut ? shaper_offset : 0;
+
+  AsmParams* patch = (AsmParams*)(synth->patch + params_offset);
+  CopyMem(params, patch, offsetof(AsmParams, osc_waves));
+  patch->samples = NULL;
+  patch->samples_right = (APTR)(params->samples_right ? params->num_samples : 0);
+  patch->osc1_func = (APTR)(osc_offsets[osc1_block] + ((UBYTE*)params->osc1_func - (UBYTE*)OscBlocks[osc1_block]));
+  patch->osc2_func = NULL;
+  patch->osc2_coupled_func = NULL;
+  patch->osc1_phase = 0;
+  patch->osc2_phase = 0;
+  patch->amp_env_lut = NULL;
+  patch->shaper_lut = NULL;
+  patch->noise_lut = NULL;
+
+  if (! params->unison_per_invs) {
+    patch->osc2_func = (APTR)(osc_offsets[osc2_block] + ((UBYTE*)params->osc2_func - (UBYTE*)OscBlocks[osc2_block]));
+  }
+
+  if (coupled) {
+    OscBlock coupled_block = osc_block(params->osc2_coupled_func);
+    patch->osc2_coupled_func =
+      (APTR)(osc_offsets[coupled_block] + ((UBYTE*)params->osc2_coupled_func - (UBYTE*)OscBlocks[coupled_block]));
+  }
+
+  patch->filter_coeffs = (APTR)filter_offset;
+  CopyMem(synth->filter_coeffs, synth->patch + filter_offset, sizeof(synth->filter_coeffs));
+
+  if (params->unison_per_invs) {
+    patch->unison_per_invs = (APTR)unison_offset;
+    CopyMem(synth->unison_per_invs, synth->patch + unison_offset, sizeof(synth->unison_per_invs));
+  }
+
+  for (UWORD osc = 0; osc < 2; ++ osc) {
+    WORD* wave_table = params->osc_waves[osc];
+    UBYTE* wave_data = synth->patch + wave_offsets[osc];
+    header->wave_kinds[osc] = wave_kinds[osc];
+    header->wave_offsets[osc] = wave_offsets[osc];
+
+    if (wave_kinds[osc] == GenWave_Custom) {
+      // Points are the entries interpolation starts from.
+      for (UWORD point = 0; point < kCustomWavePoints; ++ point) {
+        ((BYTE*)wave_data)[point] = wave_table[point * (kWaveTableSize / kCustomWavePoints)] >> kBitsPerByte;
+      }
+    }
+    else if (wave_kinds[osc] != GenWave_None) {
+      CopyMem(&wave_table[1], wave_data, GenWaveSizes[wave_kinds[osc]]);
+    }
+  }
+
+  if (params->shaper_lut) {
+    // Shaper LUT points at the center entry, the entries above it are stored.
+    WORD* shaper_table = (WORD*)params->shaper_lut - (kShaperTableSize / 2);
+    WORD* shaper_data = (WORD*)(synth->patch + shaper_offset);
+    shaper_data[0] = shaper_table[0];
+    CopyMem(&shaper_table[(kShaperTableSize / 2) + 1], &shaper_data[1], ((kShaperTableSize / 2) - 1) * sizeof(WORD));
+  }
+
+  // Generator is run as code, flush it out of the data cache.
+  if (SysBase->LibNode.lib_Version >= 37) {
+    CacheClearU();
+  }
+
+  *out_gen = synth->gen;
+  *out_gen_size = synth->gen_size;
+  *out_patch = synth->patch;
+  *out_patch_size = synth->patch_size;
+  *out_work_size = kGenWorkSize;
+  *out_render_cycles = time_generator(synth);
 
 cleanup:
+  if (! ret) {
+    free_generator(synth);
+  }
+
   return ret;
 }
+#endif
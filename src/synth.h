@@ -3,19 +3,98 @@
 
 #include "common.h"
 
+// Render state of one client. Renders on different states can run at the same
+// time, the oscillator and lookup tables they share are read-only.
+typedef struct Synth Synth;
+
+// Call once before creating any state.
 BOOL synth_init();
-VOID synth_fini();
-BOOL synth_generate(Wave osc1_wave,
+
+Synth* synth_create();
+VOID synth_delete(Synth* synth);
+
+// Number of samples per channel synth_render renders, before the loop cut.
+ULONG synth_num_samples(UWORD rate_freq,
+                        UWORD duration_ms);
+
+// Oscillator frequencies are 16.16 fixed-point Hz.
+// custom_wave holds kCustomWavePoints samples of one cycle for Wave_Custom.
+// samples and samples_right hold synth_num_samples() bytes each, samples_right
+// is NULL unless a stereo mode is selected.
+// Samples from out_loop_start to the end loop seamlessly, out_loop_start is
+// out_num_samples when no loop was found.
+VOID synth_render(Synth* synth,
+                  Wave osc1_wave,
+                  Wave osc2_wave,
+                  BYTE* custom_wave,
+                  UWORD osc_mix,
+                  Couple osc_couple,
+                  UWORD rate_freq,
+                  ULONG osc1_freq,
+                  ULONG osc2_freq,
+                  BOOL fine_tune,
+                  UWORD unison_voices,
+                  UWORD unison_spread,
+                  UWORD duration_ms,
+                  UWORD cutoff,
+                  Shape shape,
+                  UWORD gain,
+                  BOOL normalize,
+                  BOOL dither,
+                  Stereo stereo,
+                  UWORD stereo_width,
+                  Envelope* amp_env,
+                  BYTE* samples,
+                  BYTE* samples_right,
+                  ULONG* out_num_samples,
+                  ULONG* out_loop_start);
+
+// Renders into chip memory owned by the state, kept until its next render.
+// out_samples_right is NULL unless a stereo mode is selected.
+BOOL synth_generate(Synth* synth,
+                    Wave osc1_wave,
                     Wave osc2_wave,
+                    BYTE* custom_wave,
                     UWORD osc_mix,
+                    Couple osc_couple,
                     UWORD rate_freq,
-                    UWORD osc1_freq,
-                    UWORD osc2_freq,
+                    ULONG osc1_freq,
+                    ULONG osc2_freq,
+                    BOOL fine_tune,
+                    UWORD unison_voices,
+                    UWORD unison_spread,
                     UWORD duration_ms,
                     UWORD cutoff,
+                    Shape shape,
                     UWORD gain,
+                    BOOL normalize,
+                    BOOL dither,
+                    Stereo stereo,
+                    UWORD stereo_width,
                     Envelope* amp_env,
                     BYTE** out_samples,
-                    UWORD* out_num_samples);
+                    BYTE** out_samples_right,
+                    ULONG* out_num_samples,
+                    ULONG* out_loop_start);
+
+// Intro replay of the last render: a position-independent 68k routine holding
+// only the synth_asm loop and oscillators it uses, and its patch.
+// Call with a0 = patch, a1 = sample buffer of num_samples bytes per channel,
+// a2 = work area of out_work_size bytes. The generator rebuilds the tables the
+// patch leaves out and makes the Haas copy. The patch starts with the loop start
+// and the length to play after the loop cut, as longs.
+BOOL synth_make_generator(Synth* synth,
+                          APTR* out_gen,
+                          ULONG* out_gen_size,
+                          APTR* out_patch,
+                          ULONG* out_patch_size,
+                          ULONG* out_work_size,
+                          ULONG* out_render_cycles);
+
+#ifdef BEEP_HOST
+// When set, host renders also store the left channel before quantization to
+// bytes, as 16.16 fixed-point, one LONG per sample the synth writes.
+extern LONG* synth_host_exact;
+#endif
 
 #endif
@@ -0,0 +1,183 @@
+// Portable version of synth.asm.s for host tools, included by synth.c when
+// BEEP_HOST is defined. Renders the same bytes as the 68k kernel, 16-bit
+// multiplies and word truncation included.
+// Oscillator routines are told apart by the addresses of their symbols.
+
+VOID* synth_asm_wave1;
+VOID* synth_asm_wave2;
+VOID* synth_asm_noise;
+VOID* synth_asm_wave1_phase;
+VOID* synth_asm_wave2_phase;
+VOID* synth_asm_noise_phase;
+VOID* synth_asm_sync;
+VOID* synth_asm_ring;
+
+LONG* synth_host_exact;
+
+typedef struct {
+  WORD x1;
+  WORD x2;
+  WORD y1;
+  WORD y2;
+} FilterState;
+
+// High word of a 68k muls/mulu result shifted left, as "swap dn; lsl.w #shift,dn".
+static WORD host_high_shl(ULONG product,
+                          UWORD shift) {
+  return (WORD)(UWORD)((product >> kBitsPerWord) << shift);
+}
+
+// Oscillator generator at func, x being the sample index or the phase word.
+// osc1 is the oscillator 1 sample ring modulation multiplies with.
+static WORD host_osc(AsmParams* p,
+                     APTR func,
+                     ULONG x,
+                     ULONG i,
+                     UWORD per_inv,
+                     WORD osc1) {
+  if (func == &synth_asm_wave1 || func == &synth_asm_wave2) {
+    x = (UWORD)x * (ULONG)per_inv;
+  }
+
+  if (func == &synth_asm_wave1 || func == &synth_asm_wave1_phase) {
+    return p->osc_waves[0][(UWORD)x >> 8];
+  }
+
+  if (func == &synth_asm_wave2 || func == &synth_asm_wave2_phase) {
+    return p->osc_waves[1][(UWORD)x >> 8];
+  }
+
+  if (func == &synth_asm_noise || func == &synth_asm_noise_phase) {
+    if (func == &synth_asm_noise_phase) {
+      x = i;
+    }
+
+    x = ((UWORD)x * (ULONG)per_inv) * 2;
+    return ((WORD*)p->noise_lut)[(x >> kBitsPerWord) & (kNoiseTableSize - 1)];
+  }
+
+  if (func == &synth_asm_sync) {
+    x = (UWORD)x * (ULONG)p->osc1_per_inv;
+    x = ((UWORD)x * (ULONG)p->osc1_per) >> kBitsPerWord;
+    return host_osc(p, p->osc2_coupled_func, x, i, per_inv, osc1);
+  }
+
+  // synth_asm_ring
+  return host_high_shl(osc1 * host_osc(p, p->osc2_coupled_func, x, i, per_inv, osc1), 1);
+}
+
+static WORD host_mix(WORD osc1,
+                     WORD osc2,
+                     UWORD amp1,
+                     UWORD amp2) {
+  return host_high_shl(osc1 * (WORD)amp1, 1) + host_high_shl(osc2 * (WORD)amp2, 1);
+}
+
+static WORD host_filter_shape(AsmParams* p,
+                              FilterState* state,
+                              WORD x) {
+  WORD* coeffs = p->filter_coeffs;
+  ULONG acc = (ULONG)(x * coeffs[2]) + (ULONG)(state->x1 * coeffs[1]) + (ULONG)(state->x2 * coeffs[0]) +
+              (ULONG)(state->y1 * coeffs[4]) + (ULONG)(state->y2 * coeffs[3]);
+  WORD y = host_high_shl(acc, 2);
+
+  state->x2 = state->x1;
+  state->x1 = x;
+  state->y2 = state->y1;
+  state->y1 = y;
+
+  if (p->shaper_lut) {
+    y = ((WORD*)p->shaper_lut)[y >> kBitsPerByte];
+  }
+
+  return y;
+}
+
+static BYTE host_amp_clamp(AsmParams* p,
+                           WORD x,
+                           UWORD amp,
+                           UWORD* err) {
+  LONG value = x * (WORD)amp;
+  ULONG value_abs = (value < 0) ? - (ULONG)value : (ULONG)value;
+
+  if (value_abs > p->peak) {
+    p->peak = value_abs;
+  }
+
+  ULONG fed_back = (ULONG)value + *err;
+  *err = (UWORD)fed_back & p->dither_mask;
+
+  UWORD sample_word = fed_back >> kBitsPerWord;
+  UWORD overflow = sample_word & 0xFF80;
+
+  if (overflow && overflow != 0xFF80) {
+    return (overflow & 0x8000) ? -0x80 : 0x7F;
+  }
+
+  return (BYTE)sample_word;
+}
+
+VOID synth_asm(AsmParams* p) {
+  BYTE* samples = p->samples;
+  BYTE* samples_right = p->samples_right;
+  FilterState state = { 0 };
+  FilterState state_right = { 0 };
+  ULONG env_phase = p->env_phase;
+
+  p->peak = 0;
+  p->quant_err = 0;
+  p->quant_err_r = 0;
+
+  for (ULONG i = kFirstSample; i != p->num_samples; ++ i) {
+    WORD osc1 = 0;
+    WORD osc2 = 0;
+    WORD mix;
+
+    if (p->unison_per_invs) {
+      LONG sum = 0;
+
+      for (UWORD* per_inv = p->unison_per_invs; *per_inv; ++ per_inv) {
+        sum += host_osc(p, p->osc1_func, i, i, *per_inv, 0);
+      }
+
+      mix = host_high_shl((WORD)(sum >> p->unison_shift) * (WORD)p->unison_amp_scale, 2);
+    }
+    else {
+      if (p->osc1_phase_inc) {
+        ULONG osc1_phase = p->osc1_phase + p->osc1_phase_inc;
+
+        if (osc1_phase < p->osc1_phase && p->osc2_sync) {
+          p->osc2_phase = 0;
+        }
+
+        p->osc1_phase = osc1_phase;
+        p->osc2_phase += p->osc2_phase_inc;
+        osc1 = host_osc(p, p->osc1_func, p->osc1_phase >> kBitsPerWord, i, p->osc1_per_inv, 0);
+        osc2 = host_osc(p, p->osc2_func, p->osc2_phase >> kBitsPerWord, i, p->osc2_per_inv, osc1);
+      }
+      else {
+        osc1 = host_osc(p, p->osc1_func, i, i, p->osc1_per_inv, 0);
+        osc2 = host_osc(p, p->osc2_func, i, i, p->osc2_per_inv, osc1);
+      }
+
+      mix = host_mix(osc1, osc2, p->osc1_amp_scale, p->osc2_amp_scale);
+    }
+
+    env_phase += p->env_phase_inc;
+    UWORD amp = ((UWORD*)p->amp_env_lut)[env_phase >> (kBitsPerWord + kBitsPerByte)];
+
+    WORD y = host_filter_shape(p, &state, mix);
+
+    if (synth_host_exact) {
+      synth_host_exact[i - kFirstSample] = y * (WORD)amp;
+    }
+
+    *samples++ = host_amp_clamp(p, y, amp, &p->quant_err);
+
+    // Unison is always mono, stereo unison copies the left channel.
+    if (samples_right && ! p->unison_per_invs) {
+      mix = host_mix(osc1, osc2, p->osc1_amp_scale_r, p->osc2_amp_scale_r);
+      *samples_right++ = host_amp_clamp(p, host_filter_shape(p, &state_right, mix), amp, &p->quant_err_r);
+    }
+  }
+}
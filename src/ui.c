@@ -20,7 +20,12 @@
 #define kFontNGlyphsX 0x10
 #define kFontNGlyphsY 0x6
 #define kFontNGlyphs (kFontNGlyphsX * kFontNGlyphsY)
-#define kNumWidgets 14
+#define kNumPages 2
+#define kNumMainWidgets 17
+#define kNumSetupWidgets 12
+#define kNumWidgets (kNumMainWidgets + kNumSetupWidgets)
+#define kMaxFrames 7
+#define kValueTextMaxLen 8
 #define kWidgetTitleGap 4
 #define kColorBG 0x222
 #define kColorDark 0x555
@@ -34,17 +39,33 @@
 #define kUIGapTop ((kScreenHeight - (kUIRowStride * kUINumRows)) / 2)
 #define kUIGapRowTop (kUIRowStride - 0x20 - (2 * kFontHeight) - kWidgetTitleGap)
 #define kKnobOscMixRange 0, 100, 1
-#define kKnobOscDetuneRange 0, 24, 1
-#define kKnobOctaveRange 1, 5, 1
+#define kKnobOscDetuneRange 0, kMaxOscDetune, 1
+#define kKnobOscCoupleRange 0, kNumCouples - 1, 1
+#define kKnobUnisonRange 1, kMaxUnisonVoices, 1
+#define kKnobOctaveRange kMinOctaveBase, kMaxOctaveBase, 1
 #define kKnobLFORange 1, 100, 1
 #define kKnobLFOModRange 0, 3, 1
 #define kKnobLFOAmtRange 0, 100, 1
-#define kKnobCutoffRange 100, 4000, 10
+#define kKnobCutoffRange kMinCutoff, kMaxCutoff, 10
+#define kKnobShapeRange 0, kNumShapes - 1, 1
 #define kKnobEchoLagRange 1, 50, 1
 #define kKnobEchoMixRange 1, 99, 1
-#define kKnobLengthRange 100, 1500, 10
-#define kKnobRateRange 0, 33, 1
+#define kKnobLengthRange kMinLengthMs, kMaxLengthMs, 10
+#define kKnobRateRange 0, kMaxSampleRateIdx, 1
 #define kKnobGainRange 0, kDbScaleRange * 10, 10 / kDbScaleSteps
+#define kKnobTuneRange 0, 1, 1
+#define kKnobNormalizeRange 0, 1, 1
+#define kKnobDitherRange 0, 1, 1
+#define kKnobStereoRange 0, kNumStereoModes - 1, 1
+#define kKnobStereoWidthRange 0, 100, 1
+#define kKnobSizeBudgetRange kSizeBudgetOff, kMaxSizeBudgetSteps, 1
+#define kKnobFibDeltaRange 0, 1, 1
+#define kKnobKeymapRange 0, kNumKeymapNotes - 1, 1
+#define kKnobFormatRange 0, kNumFormats - 1, 1
+#define kKnobCacheBudgetRange 0, 0x20, 1
+#define kSizeBudgetOff (kMinSizeBudgetSteps - 1) // size budget knob step meaning no budget
+#define kCacheBudgetStep 0x4000 // bytes per cache budget knob step
+#define kCustomWaveWidth 0x80
 #define kPtrSprEdge 0x10
 #define kPtrSprDepth 2
 #define kPtrSprHdrSizeW 2
@@ -52,16 +73,33 @@
 #define kPtrSprOffY -1
 #define kDragDeltaScale 10
 #define kTitleTextGap 4
+#define kOutputFrame 5
 
 typedef enum {
   WTT_Title, WTT_Value
 } WidgetTextType;
 
+typedef enum {
+  Page_Main, Page_Setup
+} Page;
+
+typedef struct {
+  BYTE text[kValueTextMaxLen];
+  UWORD text_len;
+  WORD center_off;
+} ValueText;
+
 static struct {
   struct Screen* screen;
   struct Window* window;
   struct BitMap shadow_font_bmaps[2];
   Widget* widgets[kNumWidgets];
+  Widget* osc_detune_widget;
+  Widget* length_widget;
+  Widget* rate_widget;
+  BYTE output_title[22];
+  ValueText value_texts[kNumWidgets];
+  UWORD page;
   struct MsgPort* input_mp;
   struct IOStdReq* input_io;
   struct InputEvent mouse_move_ev;
@@ -70,7 +108,8 @@ static struct {
 static UWORD __chip ShadowFontBpls[2][kScreenDepth][(kFontNGlyphs * kFontWidth * kFontHeight) / kBitsPerWord];
 static UWORD __chip PointerSprs[2][(2 * kPtrSprHdrSizeW) + ((kPtrSprEdge * kPtrSprEdge * kPtrSprDepth) / kBitsPerWord)];
 
-// Bits [0:3] = semitone
+// Bits [0:3] = semitone, or bank slot
+//      [5]   = key selects a bank slot
 //      [6]   = key has a valid note assigned
 //      [7]   = 0 for low octave, 1 for high octave
 static UBYTE KeyDecodeTable[0x80] = {
@@ -81,7 +120,8 @@ static UBYTE KeyDecodeTable[0x80] = {
   Semi_FS | (3 << 6), // key: 5
   Semi_GS | (3 << 6), // key: 6
   Semi_AS | (3 << 6), // key: 7
-  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0,
+  0x0     | (1 << 5), // key: keypad 0
   Semi_C  | (3 << 6), // key: Q
   Semi_D  | (3 << 6), // key: W
   Semi_E  | (3 << 6), // key: E
@@ -89,14 +129,22 @@ static UBYTE KeyDecodeTable[0x80] = {
   Semi_G  | (3 << 6), // key: T
   Semi_A  | (3 << 6), // key: Y
   Semi_B  | (3 << 6), // key: U
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0,
+  0x1     | (1 << 5), // key: keypad 1
+  0x2     | (1 << 5), // key: keypad 2
+  0x3     | (1 << 5), // key: keypad 3
+  0,
   Semi_CS | (1 << 6), // key: S
   Semi_DS | (1 << 6), // key: D
   0,
   Semi_FS | (1 << 6), // key: G
   Semi_GS | (1 << 6), // key: H
   Semi_AS | (1 << 6), // key: J
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0,
+  0x4     | (1 << 5), // key: keypad 4
+  0x5     | (1 << 5), // key: keypad 5
+  0x6     | (1 << 5), // key: keypad 6
+  0,
   Semi_C  | (1 << 6), // key: Z
   Semi_D  | (1 << 6), // key: X
   Semi_E  | (1 << 6), // key: C
@@ -104,12 +152,66 @@ static UBYTE KeyDecodeTable[0x80] = {
   Semi_G  | (1 << 6), // key: B
   Semi_A  | (1 << 6), // key: N
   Semi_B  | (1 << 6), // key: M
+  0, 0, 0, 0, 0,
+  0x7     | (1 << 5), // key: keypad 7
+  0x8     | (1 << 5), // key: keypad 8
+  0x9     | (1 << 5), // key: keypad 9
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0xE     | (1 << 5), // key: keypad -
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0xA     | (1 << 5), // key: keypad (
+  0xB     | (1 << 5), // key: keypad )
+  0xC     | (1 << 5), // key: keypad /
+  0xD     | (1 << 5), // key: keypad *
+  0xF     | (1 << 5), // key: keypad +
+};
+
+// Widgets of each page occupy a contiguous range of g.widgets.
+static UWORD PageWidgetRanges[kNumPages][2] = {
+  { 0,               kNumMainWidgets },
+  { kNumMainWidgets, kNumWidgets     },
+};
+
+static STRPTR WidgetTitles[kNumWidgets] = {
+  "WAVES", "MIX", "DETUNE", "FREQ", "MOD", "AMT",
+  "CUTOFF", "LAG", "MIX", "GAIN", "ENVELOPE",
+  "OCTAVE", "LENGTH", "RATE", "COUPLE", "SHAPE", "UNISON",
+  "DRAW", "NORM", "DITHER", "TUNE", "LOW", "HIGH", "STEREO", "WIDTH",
+  "FORMAT", "8SVX", "BUDGET", "CACHE",
 };
 
 static STRPTR SemitoneNames[12] = {
   "C-", "C#", "D-", "D#", "E-", "F-", "F#", "G-", "G#", "A-", "A#", "B-"
 };
 
+static STRPTR CoupleNames[kNumCouples] = {
+  " MIX", "SYNC", "RING"
+};
+
+static STRPTR ShapeNames[kNumShapes] = {
+  "  OFF", " TANH", " FOLD", "CRUSH"
+};
+
+static STRPTR TuneNames[2] = {
+  "ROUND", "EXACT"
+};
+
+static STRPTR OffOnNames[2] = {
+  "OFF", " ON"
+};
+
+static STRPTR StereoNames[kNumStereoModes] = {
+  " OFF", " PAN", "HAAS"
+};
+
+static STRPTR FibDeltaNames[2] = {
+  "RAW", "FIB"
+};
+
+static STRPTR FormatNames[kNumFormats] = {
+  "8SVX", " RAW", " ASM", "   C"
+};
+
 static BOOL make_shadow_font() {
   BOOL ret = TRUE;
 
@@ -169,6 +271,28 @@ static VOID draw_widget_text(Widget* widget,
                              UWORD text_len,
                              WORD center_off,
                              WidgetTextType text_type) {
+  UWORD widget_idx = 0;
+
+  while (g.widgets[widget_idx] != widget) {
+    ++ widget_idx;
+  }
+
+  // Remember value text so it can be redrawn when the page is shown again.
+  if (text_type == WTT_Value) {
+    ValueText* value_text = &g.value_texts[widget_idx];
+    value_text->text_len = MIN(text_len, kValueTextMaxLen);
+    value_text->center_off = center_off;
+
+    for (UWORD i = 0; i < value_text->text_len; ++ i) {
+      value_text->text[i] = text[i];
+    }
+  }
+
+  if (g.page >= kNumPages ||
+      widget_idx < PageWidgetRanges[g.page][0] || widget_idx >= PageWidgetRanges[g.page][1]) {
+    return;
+  }
+
   UWORD text_x =
     ((widget->pos_tl[0] + widget->pos_br[0] + 1) / 2) -
     (((text_len - center_off) * kFontWidth) / 2);
@@ -180,6 +304,74 @@ static VOID draw_widget_text(Widget* widget,
   draw_shadow_text(text, text_len, text_x, text_y, (text_type == WTT_Title) ? kPenDark : kPenColor);
 }
 
+static VOID int_to_str(LONG value,
+                       STRPTR str,
+                       UWORD width) {
+  BOOL negative = (value < 0);
+
+  if (negative) {
+    value = - value;
+  }
+
+  do {
+    UWORD rem = value % 10;
+    value /= 10;
+
+    str[-- width] = '0' + rem;
+  } while (value != 0);
+
+  if (negative) {
+    str[-- width] = '-';
+  }
+}
+
+static VOID draw_frame_title(UWORD title_idx,
+                             STRPTR text,
+                             UWORD text_len) {
+  UWORD frame_y_off = kUIGapTop + (kUIGapRowTop / 2);
+
+  UWORD title_centers[kMaxFrames][2] = {
+    { kScreenWidth / 4,       0                },
+    { (kScreenWidth * 3) / 4, 0                },
+    { kUIColStride / 2,       kUIRowStride     },
+    { kUIColStride * 2,       kUIRowStride     },
+    { (kScreenWidth * 3) / 4, kUIRowStride     },
+    { kScreenWidth / 4,       kUIRowStride * 2 },
+    { (kScreenWidth * 3) / 4, kUIRowStride * 2 },
+  };
+
+  WORD text_w = (text_len * kFontWidth) - 1;
+  UWORD text_x = title_centers[title_idx][0] - (text_w / 2);
+  UWORD text_y = title_centers[title_idx][1] + frame_y_off + ((kFontHeight + 1) / 2);
+
+  // Clear padded area around text.
+  SetAPen(g.window->RPort, kPenBG);
+  RectFill(g.window->RPort,
+           text_x - kTitleTextGap, text_y - (kFontHeight - 1) - kTitleTextGap,
+           text_x + kTitleTextGap + text_w - 1, text_y + kTitleTextGap);
+  WaitBlit();
+
+  draw_shadow_text(text, text_len, text_x, text_y, kPenDark);
+}
+
+// Sample output frame title shows the estimated packed size once a sample is rendered.
+static VOID draw_output_title() {
+  ULONG packed_size = model_get_packed_size();
+
+  if (! packed_size) {
+    return;
+  }
+
+  BYTE title_str[sizeof(g.output_title)] = "SAMPLE       B PACKED";
+  int_to_str(packed_size, title_str + 7, 6);
+
+  CopyMem(title_str, g.output_title, sizeof(g.output_title));
+
+  if (g.page == Page_Main) {
+    draw_frame_title(kOutputFrame, g.output_title, str_len(g.output_title));
+  }
+}
+
 static VOID draw_widget_frames() {
   UWORD frame_y_off = kUIGapTop + (kUIGapRowTop / 2);
 
@@ -205,57 +397,24 @@ static VOID draw_widget_frames() {
     Draw(g.window->RPort, offset + kUIColStride, offset + (2 * kUIRowStride) + frame_y_off);
   }
 
-  // Frame heading titles.
-  STRPTR frame_titles[] = {
-    "VFO SOURCE", "LFO MODULATOR", "FILTER",
-    "ECHO", "AMPLITUDE", "SAMPLE OUTPUT"
+  // Frame heading titles, both pages share the same frame layout.
+  STRPTR frame_titles[kNumPages][kMaxFrames] = {
+    {
+      "VFO SOURCE", "LFO MODULATOR", "FILTER",
+      "ECHO", "AMPLITUDE", g.output_title, "VOICE"
+    },
+    {
+      "CUSTOM WAVE", "OUTPUT", "TUNING",
+      "KEYMAP", "STEREO", "EXPORT", "SIZE"
+    },
   };
 
-  UWORD title_centers[][2] = {
-    { kScreenWidth / 4,       0                },
-    { (kScreenWidth * 3) / 4, 0                },
-    { kUIColStride / 2,       kUIRowStride     },
-    { kUIColStride * 2,       kUIRowStride     },
-    { (kScreenWidth * 3) / 4, kUIRowStride     },
-    { kScreenWidth / 4,       kUIRowStride * 2 },
-  };
-
-  for (UWORD title_idx = 0; title_idx < ARRAY_SIZE(frame_titles); ++ title_idx) {
-    STRPTR text = frame_titles[title_idx];
-    UWORD text_len = str_len(text);
-    WORD text_w = (text_len * kFontWidth) - 1;
-    UWORD text_x = title_centers[title_idx][0] - (text_w / 2);
-    UWORD text_y = title_centers[title_idx][1] + frame_y_off + ((kFontHeight + 1) / 2);
-
-    // Clear padded area around text.
-    SetAPen(g.window->RPort, kPenBG);
-    RectFill(g.window->RPort,
-             text_x - kTitleTextGap, text_y - (kFontHeight - 1) - kTitleTextGap,
-             text_x + kTitleTextGap + text_w - 1, text_y + kTitleTextGap);
-    WaitBlit();
-
-    draw_shadow_text(text, text_len, text_x, text_y, kPenDark);
-  }
-}
-
-static VOID int_to_str(WORD value,
-                       STRPTR str,
-                       UWORD width) {
-  BOOL negative = (value < 0);
-
-  if (negative) {
-    value = - value;
-  }
+  for (UWORD title_idx = 0; title_idx < kMaxFrames; ++ title_idx) {
+    STRPTR text = frame_titles[g.page][title_idx];
 
-  do {
-    UWORD rem = value % 10;
-    value /= 10;
-
-    str[-- width] = '0' + rem;
-  } while (value != 0);
-
-  if (negative) {
-    str[-- width] = '-';
+    if (text) {
+      draw_frame_title(title_idx, text, str_len(text));
+    }
   }
 }
 
@@ -275,13 +434,49 @@ static VOID osc_mix_changed(Widget* widget,
   draw_widget_text(widget, value_str, sizeof(value_str), -1, WTT_Value);
 }
 
+static VOID draw_osc_detune(Widget* widget,
+                            WORD value) {
+  // Detune is the unison spread in cents when unison voices are enabled.
+  if (model_get_unison_voices() > 1) {
+    BYTE value_str[5] = "   CT";
+    int_to_str(value * kUnisonCentsPerDetune, value_str, 2);
+    draw_widget_text(widget, value_str, sizeof(value_str), 0, WTT_Value);
+  }
+  else {
+    BYTE value_str[5] = "  /12";
+    int_to_str(value, value_str, 2);
+    draw_widget_text(widget, value_str, sizeof(value_str), 0, WTT_Value);
+  }
+}
+
 static VOID osc_detune_changed(Widget* widget,
                                WORD value) {
   model_set_osc_detune(value);
+  draw_osc_detune(widget, value);
+}
+
+static VOID osc_couple_changed(Widget* widget,
+                               WORD value) {
+  model_set_osc_couple(value);
+
+  STRPTR value_str = CoupleNames[value];
+  draw_widget_text(widget, value_str, str_len(value_str), 0, WTT_Value);
+}
+
+static VOID unison_changed(Widget* widget,
+                           WORD value) {
+  model_set_unison_voices(value);
+
+  BYTE value_str[3] = "OFF";
+
+  if (value > 1) {
+    value_str[0] = ' ';
+    value_str[1] = '0' + value;
+    value_str[2] = 'X';
+  }
 
-  BYTE value_str[5] = "  /12";
-  int_to_str(value, value_str, 2);
   draw_widget_text(widget, value_str, sizeof(value_str), 0, WTT_Value);
+  draw_osc_detune(g.osc_detune_widget, model_get_osc_detune());
 }
 
 static VOID lfo_changed(Widget* widget,
@@ -313,6 +508,14 @@ static VOID cutoff_changed(Widget* widget,
   draw_widget_text(widget, value_str, sizeof(value_str), 0, WTT_Value);
 }
 
+static VOID shape_changed(Widget* widget,
+                          WORD value) {
+  model_set_shape(value);
+
+  STRPTR value_str = ShapeNames[value];
+  draw_widget_text(widget, value_str, str_len(value_str), 0, WTT_Value);
+}
+
 static VOID echo_lag_changed(Widget* widget,
                              WORD value) {
   BYTE value_str[3] = "  %";
@@ -349,13 +552,41 @@ static VOID octave_changed(Widget* widget,
   draw_widget_text(widget, octave_str, sizeof(octave_str), 0, WTT_Value);
 }
 
+// Length and rate show what is rendered, which the size budget may override.
+static VOID draw_length(Widget* widget) {
+  PTNote rate;
+  UWORD length_ms;
+  model_get_render_size(&rate, &length_ms);
+
+  BYTE value_str[7] = "     MS";
+  int_to_str(length_ms, value_str, 4);
+  draw_widget_text(widget, value_str, sizeof(value_str), -1, WTT_Value);
+}
+
+static VOID draw_rate(Widget* widget) {
+  PTNote rate;
+  UWORD length_ms;
+  model_get_render_size(&rate, &length_ms);
+
+  STRPTR semi_name = SemitoneNames[rate.semitone];
+  BYTE rate_str[] = { semi_name[0], semi_name[1], '1' + rate.pt_octave };
+  draw_widget_text(widget, rate_str, sizeof(rate_str), 0, WTT_Value);
+}
+
+static VOID draw_render_size() {
+  draw_length(g.length_widget);
+  draw_rate(g.rate_widget);
+}
+
 static VOID length_changed(Widget* widget,
                            WORD value) {
   model_set_length_ms(value);
+  draw_length(widget);
 
-  BYTE value_str[7] = "     MS";
-  int_to_str(value, value_str, 4);
-  draw_widget_text(widget, value_str, sizeof(value_str), -1, WTT_Value);
+  // The size budget trades rate for length, rate knob isn't made yet on first call.
+  if (g.rate_widget) {
+    draw_rate(g.rate_widget);
+  }
 }
 
 static VOID rate_changed(Widget* widget,
@@ -366,10 +597,109 @@ static VOID rate_changed(Widget* widget,
   };
 
   model_set_sample_rate(&rate);
+  draw_rate(widget);
+}
 
-  STRPTR semi_name = SemitoneNames[rate.semitone];
-  BYTE rate_str[] = { semi_name[0], semi_name[1], '1' + rate.pt_octave };
-  draw_widget_text(widget, rate_str, sizeof(rate_str), 0, WTT_Value);
+static VOID custom_wave_changed(Widget* widget,
+                                BYTE* points) {
+  model_set_custom_wave(points);
+}
+
+static VOID tune_changed(Widget* widget,
+                         WORD value) {
+  model_set_fine_tune(value);
+  draw_widget_text(widget, TuneNames[value], str_len(TuneNames[value]), 0, WTT_Value);
+}
+
+static VOID normalize_changed(Widget* widget,
+                              WORD value) {
+  model_set_normalize(value);
+  draw_widget_text(widget, OffOnNames[value], str_len(OffOnNames[value]), 0, WTT_Value);
+}
+
+static VOID dither_changed(Widget* widget,
+                           WORD value) {
+  model_set_dither(value);
+  draw_widget_text(widget, OffOnNames[value], str_len(OffOnNames[value]), 0, WTT_Value);
+}
+
+static VOID stereo_changed(Widget* widget,
+                           WORD value) {
+  model_set_stereo(value);
+  draw_widget_text(widget, StereoNames[value], str_len(StereoNames[value]), 0, WTT_Value);
+  draw_render_size();
+}
+
+static VOID stereo_width_changed(Widget* widget,
+                                 WORD value) {
+  model_set_stereo_width(value);
+
+  BYTE value_str[4] = "   %";
+  int_to_str(value, value_str, 3);
+  draw_widget_text(widget, value_str, sizeof(value_str), 0, WTT_Value);
+}
+
+static VOID format_changed(Widget* widget,
+                           WORD value) {
+  model_set_export_format(value);
+  draw_widget_text(widget, FormatNames[value], str_len(FormatNames[value]), 0, WTT_Value);
+}
+
+static VOID fib_delta_changed(Widget* widget,
+                              WORD value) {
+  model_set_fib_delta(value);
+  draw_widget_text(widget, FibDeltaNames[value], str_len(FibDeltaNames[value]), 0, WTT_Value);
+}
+
+static VOID draw_keymap_note(Widget* widget,
+                             WORD value) {
+  STRPTR semi_name = SemitoneNames[value % 12];
+  BYTE note_str[] = { semi_name[0], semi_name[1], '1' + (value / 12) };
+  draw_widget_text(widget, note_str, sizeof(note_str), 0, WTT_Value);
+}
+
+static VOID keymap_low_changed(Widget* widget,
+                               WORD value) {
+  model_set_keymap_low(value);
+  draw_keymap_note(widget, value);
+}
+
+static VOID keymap_high_changed(Widget* widget,
+                                WORD value) {
+  model_set_keymap_high(value);
+  draw_keymap_note(widget, value);
+}
+
+// The knob's lowest step is off, the ones above start where the shortest
+// render fits.
+static VOID size_budget_changed(Widget* widget,
+                                WORD value) {
+  model_set_size_budget((value == kSizeBudgetOff) ? 0 : (value * kSizeBudgetStep));
+
+  if (value == kSizeBudgetOff) {
+    draw_widget_text(widget, OffOnNames[0], str_len(OffOnNames[0]), 0, WTT_Value);
+  }
+  else {
+    BYTE value_str[6] = "     B";
+    int_to_str(value * kSizeBudgetStep, value_str, 5);
+    draw_widget_text(widget, value_str, sizeof(value_str), -1, WTT_Value);
+  }
+
+  draw_render_size();
+}
+
+static VOID cache_budget_changed(Widget* widget,
+                                 WORD value) {
+  model_set_cache_budget(value * kCacheBudgetStep);
+
+  if (value == 0) {
+    draw_widget_text(widget, OffOnNames[0], str_len(OffOnNames[0]), 0, WTT_Value);
+  }
+  else {
+    BYTE value_str[4] = "   K";
+    int_to_str((value * kCacheBudgetStep) >> 10, value_str, 3);
+    draw_widget_text(widget, value_str, sizeof(value_str), 0, WTT_Value);
+  }
 }
 
 static BOOL make_widgets() {
@@ -387,6 +717,7 @@ static BOOL make_widgets() {
                           model_get_osc_mix(), osc_mix_changed, &g.widgets[next_widget_idx ++]));
   CHECK(widgets_make_knob(kUIGapLeft + (2 * kUIColStride), widget_top, kKnobOscDetuneRange,
                           model_get_osc_detune(), osc_detune_changed, &g.widgets[next_widget_idx ++]));
+  g.osc_detune_widget = g.widgets[next_widget_idx - 1];
   CHECK(widgets_make_knob(kUIGapLeft + (3 * kUIColStride), widget_top, kKnobLFORange,
                           50, lfo_changed, &g.widgets[next_widget_idx ++]));
   CHECK(widgets_make_knob(kUIGapLeft + (4 * kUIColStride), widget_top, kKnobLFOModRange,
@@ -413,19 +744,102 @@ static BOOL make_widgets() {
                           model_get_octave_base(), octave_changed, &g.widgets[next_widget_idx ++]));
   CHECK(widgets_make_knob(kUIGapLeft + (1 * kUIColStride), widget_top, kKnobLengthRange,
                           model_get_length_ms(), length_changed, &g.widgets[next_widget_idx ++]));
+  g.length_widget = g.widgets[next_widget_idx - 1];
   CHECK(widgets_make_knob(kUIGapLeft + (2 * kUIColStride), widget_top, kKnobRateRange,
                           rate_knob_init, rate_changed, &g.widgets[next_widget_idx ++]));
+  g.rate_widget = g.widgets[next_widget_idx - 1];
+  CHECK(widgets_make_knob(kUIGapLeft + (3 * kUIColStride), widget_top, kKnobOscCoupleRange,
+                          model_get_osc_couple(), osc_couple_changed, &g.widgets[next_widget_idx ++]));
+  CHECK(widgets_make_knob(kUIGapLeft + (4 * kUIColStride), widget_top, kKnobShapeRange,
+                          model_get_shape(), shape_changed, &g.widgets[next_widget_idx ++]));
+  CHECK(widgets_make_knob(kUIGapLeft + (5 * kUIColStride), widget_top, kKnobUnisonRange,
+                          model_get_unison_voices(), unison_changed, &g.widgets[next_widget_idx ++]));
+
+  // Setup page, top row of widgets
+  widget_top = kUIGapTop + kUIGapRowTop + (0 * kUIRowStride);
+  CHECK(widgets_make_custom_wave((kScreenWidth / 4) - (kCustomWaveWidth / 2), widget_top,
+                                 model_get_custom_wave(), custom_wave_changed, &g.widgets[next_widget_idx ++]));
+  CHECK(widgets_make_knob(kUIGapLeft + (3 * kUIColStride), widget_top, kKnobNormalizeRange,
+                          model_get_normalize(), normalize_changed, &g.widgets[next_widget_idx ++]));
+  CHECK(widgets_make_knob(kUIGapLeft + (4 * kUIColStride), widget_top, kKnobDitherRange,
+                          model_get_dither(), dither_changed, &g.widgets[next_widget_idx ++]));
+
+  // Setup page, middle row of widgets
+  widget_top += kUIRowStride;
+  CHECK(widgets_make_knob(kUIGapLeft + (0 * kUIColStride), widget_top, kKnobTuneRange,
+                          model_get_fine_tune(), tune_changed, &g.widgets[next_widget_idx ++]));
+  CHECK(widgets_make_knob(kUIGapLeft + (1 * kUIColStride), widget_top, kKnobKeymapRange,
+                          model_get_keymap_low(), keymap_low_changed, &g.widgets[next_widget_idx ++]));
+  CHECK(widgets_make_knob(kUIGapLeft + (2 * kUIColStride), widget_top, kKnobKeymapRange,
+                          model_get_keymap_high(), keymap_high_changed, &g.widgets[next_widget_idx ++]));
+  CHECK(widgets_make_knob(kUIGapLeft + (3 * kUIColStride), widget_top, kKnobStereoRange,
+                          model_get_stereo(), stereo_changed, &g.widgets[next_widget_idx ++]));
+  CHECK(widgets_make_knob(kUIGapLeft + (4 * kUIColStride), widget_top, kKnobStereoWidthRange,
+                          model_get_stereo_width(), stereo_width_changed, &g.widgets[next_widget_idx ++]));
+
+  // Setup page, bottom row of widgets
+  widget_top += kUIRowStride;
+  CHECK(widgets_make_knob(kUIGapLeft + (0 * kUIColStride), widget_top, kKnobFormatRange,
+                          model_get_export_format(), format_changed, &g.widgets[next_widget_idx ++]));
+  CHECK(widgets_make_knob(kUIGapLeft + (1 * kUIColStride), widget_top, kKnobFibDeltaRange,
+                          model_get_fib_delta(), fib_delta_changed, &g.widgets[next_widget_idx ++]));
+  CHECK(widgets_make_knob(kUIGapLeft + (3 * kUIColStride), widget_top, kKnobSizeBudgetRange,
+                          model_get_size_budget() ? (model_get_size_budget() / kSizeBudgetStep) : kSizeBudgetOff,
+                          size_budget_changed,
+                          &g.widgets[next_widget_idx ++]));
+  CHECK(widgets_make_knob(kUIGapLeft + (4 * kUIColStride), widget_top, kKnobCacheBudgetRange,
+                          model_get_cache_budget() / kCacheBudgetStep, cache_budget_changed,
+                          &g.widgets[next_widget_idx ++]));
 
-  STRPTR widget_titles[kNumWidgets] = {
-    "WAVES", "MIX", "DETUNE", "FREQ", "MOD", "AMT",
-    "CUTOFF", "LAG", "MIX", "GAIN", "ENVELOPE",
-    "OCTAVE", "LENGTH", "RATE",
-  };
+cleanup:
+  return ret;
+}
 
+static VOID free_widgets() {
   for (UWORD i = 0; i < kNumWidgets; ++ i) {
-    draw_widget_text(g.widgets[i], widget_titles[i], str_len(widget_titles[i]), 0, WTT_Title);
+    if (g.widgets[i]) {
+      g.widgets[i]->free(g.widgets[i]);
+      g.widgets[i] = NULL;
+    }
+  }
+
+  g.osc_detune_widget = NULL;
+  g.length_widget = NULL;
+  g.rate_widget = NULL;
+}
+
+static VOID show_page(UWORD page) {
+  g.page = page;
+
+  SetRast(g.window->RPort, kPenBG);
+  WaitBlit();
+  draw_widget_frames();
+
+  for (UWORD i = PageWidgetRanges[page][0]; i < PageWidgetRanges[page][1]; ++ i) {
+    ValueText* value_text = &g.value_texts[i];
+
+    draw_widget_text(g.widgets[i], WidgetTitles[i], str_len(WidgetTitles[i]), 0, WTT_Title);
     g.widgets[i]->render(g.widgets[i]);
+
+    if (value_text->text_len > 0) {
+      draw_widget_text(g.widgets[i], value_text->text, value_text->text_len,
+                       value_text->center_off, WTT_Value);
+    }
   }
+}
+
+// After the model changed as a whole, widgets are made again from it so each
+// shows its value. Their callbacks only store the same values again, the
+// sample is rendered once when next played.
+static BOOL remake_widgets() {
+  BOOL ret = TRUE;
+  UWORD page = g.page;
+
+  free_widgets();
+
+  g.page = kNumPages;
+  CHECK(make_widgets());
+  show_page(page);
 
 cleanup:
   return ret;
@@ -487,8 +901,15 @@ BOOL ui_init() {
   SetPointer(g.window, PointerSprs[0], kPtrSprEdge, kPtrSprEdge, kPtrSprOffX, kPtrSprOffY);
 
   CHECK(make_shadow_font());
-  draw_widget_frames();
+
+  STRPTR output_title = "SAMPLE OUTPUT";
+  CopyMem(output_title, g.output_title, str_len(output_title) + 1);
+
+  // Widgets report their initial values while being made, hold off drawing
+  // until the first page is shown.
+  g.page = kNumPages;
   CHECK(make_widgets());
+  show_page(Page_Main);
 
   g.mouse_move_ev.ie_NextEvent = NULL;
   g.mouse_move_ev.ie_Class = IECLASS_POINTERPOS;
@@ -519,11 +940,7 @@ VOID ui_fini() {
     DeletePort(g.input_mp);
   }
 
-  for (UWORD i = 0; i < kNumWidgets; ++ i) {
-    if (g.widgets[i]) {
-      g.widgets[i]->free(g.widgets[i]);
-    }
-  }
+  free_widgets();
 
   if (g.window) {
     CloseWindow(g.window);
@@ -536,7 +953,7 @@ VOID ui_fini() {
 
 BOOL ui_handle_events() {
   BOOL ret = TRUE;
-  ULONG wait_signals = (1 << g.window->UserPort->mp_SigBit) | SIGBREAKF_CTRL_C;
+  ULONG wait_signals = (1 << g.window->UserPort->mp_SigBit) | SIGBREAKF_CTRL_C | model_export_signal();
   PTOctave keys_octave_base = PTOct_2;
   Widget* active_widget = NULL;
   UWORD clicked_pos[2] = { 0, 0 };
@@ -548,13 +965,21 @@ BOOL ui_handle_events() {
       running = FALSE;
     }
 
+    // Export finished in the background, flash the screen if it failed.
+    if (signals & model_export_signal()) {
+      if (! model_export_finish()) {
+        DisplayBeep(g.screen);
+      }
+    }
+
     for (struct IntuiMessage* msg;
          msg = (struct IntuiMessage*)GetMsg(g.window->UserPort); ) {
       switch (msg->Class) {
       case IDCMP_RAWKEY: {
         UWORD allow_qual_mask =
           IEQUALIFIER_LSHIFT | IEQUALIFIER_RSHIFT |          // allow shift keys, useful when dragging knob
-          IEQUALIFIER_LEFTBUTTON | IEQUALIFIER_RELATIVEMOUSE // allow while knob clicked, relative always set
+          IEQUALIFIER_LEFTBUTTON | IEQUALIFIER_RELATIVEMOUSE | // allow while knob clicked, relative always set
+          IEQUALIFIER_NUMERICPAD                             // allow keypad, selects bank slots
         ;
 
         if ((msg->Code & IECODE_UP_PREFIX) == 0 &&           // ignore key release
@@ -574,12 +999,87 @@ BOOL ui_handle_events() {
 
           case 0x52: // F3
             CHECK(model_export_sample());
+            draw_output_title();
+            break;
+
+          case 0x53: // F4
+            CHECK(model_export_generator());
+            draw_output_title();
+            break;
+
+          case 0x54: // F5
+            CHECK(model_export_keymap());
+            break;
+
+          case 0x55: // F6
+            if (! model_save_patch(model_get_export_name())) {
+              DisplayBeep(g.screen);
+            }
+
+            break;
+
+          case 0x56: // F7
+            if (! active_widget) {
+              model_history_begin();
+
+              if (model_load_patch(model_get_export_name())) {
+                model_history_commit();
+                CHECK(remake_widgets());
+              }
+              else {
+                DisplayBeep(g.screen);
+              }
+            }
+
+            break;
+
+          case 0x57: // F8, shift to export files too
+            if (! model_morph((msg->Qualifier & (IEQUALIFIER_LSHIFT | IEQUALIFIER_RSHIFT)) != 0)) {
+              DisplayBeep(g.screen);
+            }
+
+            break;
+
+          case 0x41: // Backspace, shift to redo
+            if (! active_widget) {
+              BOOL shift = (msg->Qualifier & (IEQUALIFIER_LSHIFT | IEQUALIFIER_RSHIFT)) != 0;
+
+              if (shift ? model_redo() : model_undo()) {
+                CHECK(remake_widgets());
+              }
+            }
+
+            break;
+
+          case 0x42: // Tab
+            if (! active_widget) {
+              show_page((g.page + 1) % kNumPages);
+            }
+
             break;
 
           default:
             {
               UWORD decoded_key = KeyDecodeTable[msg->Code];
 
+              // Shift stores the patch in the slot, otherwise the slot is recalled.
+              if (decoded_key & (1 << 5)) {
+                if (msg->Qualifier & (IEQUALIFIER_LSHIFT | IEQUALIFIER_RSHIFT)) {
+                  model_store_slot(decoded_key & 0xF);
+                }
+                else if (! active_widget) {
+                  model_history_begin();
+
+                  if (model_recall_slot(decoded_key & 0xF)) {
+                    model_history_commit();
+                    CHECK(remake_widgets());
+                  }
+                  else {
+                    DisplayBeep(g.screen);
+                  }
+                }
+              }
+
               if (decoded_key & (1 << 6)) {
                 PTNote note = {
                   .semitone = decoded_key & 0xF,
@@ -587,6 +1087,7 @@ BOOL ui_handle_events() {
                 };
 
                 CHECK(model_play_note(&note));
+                draw_output_title();
               }
             }
           }
@@ -608,13 +1109,16 @@ BOOL ui_handle_events() {
 
       case IDCMP_MOUSEBUTTONS:
         if (msg->Code == SELECTDOWN) {
-          for (UWORD i = 0; i < kNumWidgets; ++ i) {
+          for (UWORD i = PageWidgetRanges[g.page][0]; i < PageWidgetRanges[g.page][1]; ++ i) {
             if (g.screen->MouseX >= g.widgets[i]->pos_tl[0] &&
                 g.screen->MouseX <= g.widgets[i]->pos_br[0] &&
                 g.screen->MouseY >= g.widgets[i]->pos_tl[1] &&
                 g.screen->MouseY <= g.widgets[i]->pos_br[1]) {
               active_widget = g.widgets[i];
 
+              // Everything changed until release is a single step of history.
+              model_history_begin();
+
               // Blank pointer sprite and remember its position.
               clicked_pos[0] = g.screen->MouseX;
               clicked_pos[1] = g.screen->MouseY;
@@ -653,6 +1157,8 @@ BOOL ui_handle_events() {
             }
           }
 
+          model_history_commit();
+
           // Stop listening to mouse move events.
           g.window->Flags &= ~WFLG_REPORTMOUSE;
 
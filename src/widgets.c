@@ -28,6 +28,12 @@
 #define kWaveBplGap (0x10 - kWaveBplHeight)
 #define kWaveDragRange 0x2000
 #define kWaveDragMax (kWaveDragRange - 1)
+#define kCustomWaveWidth 0x80
+#define kCustomWaveHeight 0x20
+#define kCustomWavePointWidth (kCustomWaveWidth / kCustomWavePoints)
+#define kCustomWavePenScale 0x10
+#define kCustomWavePenRangeX (kCustomWaveWidth * kCustomWavePenScale)
+#define kCustomWavePenRangeY (kCustomWaveHeight * kCustomWavePenScale)
 #define kAreaBufNumVecs 8 // longest chain of [Area*, AreaEnd] calls (AreaCircle = 2 vectors)
 #define kAreaBufBytesPerVec 5
 #define kTmpRasBufSizeB (kKnobArea / kBitsPerByte)
@@ -35,12 +41,15 @@
 static struct {
   struct BitMap env_lines_bmap;
   struct RastPort env_lines_rport;
+  struct BitMap custom_wave_bmap;
+  struct RastPort custom_wave_rport;
 } g;
 
 static UWORD __chip KnobBpls[kKnobNumSteps][kBplDepth][kKnobArea / kBitsPerWord];
 static UWORD __chip TmpRasBuf[DIV_ROUND_LARGEST_NN(kTmpRasBufSizeB, sizeof(UWORD))];
 static UWORD __chip EnvLinesBpls[kBplDepth][kEnvWidth * kEnvHeight / kBitsPerWord];
 static UWORD __chip WaveBpls[kNumWaves][kBplDepth][kWaveEdge * kWaveBplHeight / kBitsPerWord];
+static UWORD __chip CustomWaveBpls[kBplDepth][kCustomWaveWidth * kCustomWaveHeight / kBitsPerWord];
 
 static BOOL make_knob_bpls() {
   BOOL ret = TRUE;
@@ -197,7 +206,7 @@ static BOOL make_wave_bpls() {
 
   SetAPen(&wave_rport, kPenColor);
 
-  for (UWORD wave_idx = 0; wave_idx < 4; ++ wave_idx) {
+  for (UWORD wave_idx = 0; wave_idx < kNumWaves; ++ wave_idx) {
     for (UWORD i = 0; i < kBplDepth; ++ i) {
       wave_bmap.Planes[i] = (PLANEPTR)&WaveBpls[wave_idx][i][0];
     }
@@ -215,6 +224,19 @@ static BOOL make_wave_bpls() {
         Draw(&wave_rport, x, (UWORD)seed % line_height);
       }
     }
+    else if (wave_idx == Wave_Custom) {
+      // Freehand squiggle standing in for the user-drawn cycle.
+      WORD pts[][2] = {
+        { line_x_gap + 4,               0                    },
+        { line_x_gap + 9,               line_height - 4      },
+        { line_x_gap + 13,              line_height / 2 - 2  },
+        { kWaveEdge - 10 - line_x_gap,  line_height - 1      },
+        { kWaveEdge - 2 - line_x_gap,   line_height / 2      },
+      };
+
+      Move(&wave_rport, line_x_gap, line_height / 2);
+      PolyDraw(&wave_rport, ARRAY_SIZE(pts), (WORD*)pts);
+    }
     else {
       WORD pts[4][2];
 
@@ -275,6 +297,18 @@ BOOL widgets_init() {
   InitRastPort(&g.env_lines_rport);
   g.env_lines_rport.BitMap = &g.env_lines_bmap;
 
+  g.custom_wave_bmap.BytesPerRow = kCustomWaveWidth / kBitsPerByte;
+  g.custom_wave_bmap.Rows = kCustomWaveHeight;
+  g.custom_wave_bmap.Flags = 0;
+  g.custom_wave_bmap.Depth = kBplDepth;
+
+  for (UWORD i = 0; i < kBplDepth; ++ i) {
+    g.custom_wave_bmap.Planes[i] = (PLANEPTR)&CustomWaveBpls[i][0];
+  }
+
+  InitRastPort(&g.custom_wave_rport);
+  g.custom_wave_rport.BitMap = &g.custom_wave_bmap;
+
   CHECK(make_knob_bpls());
   CHECK(make_wave_bpls());
 
@@ -285,22 +319,22 @@ cleanup:
 VOID widgets_fini() {
 }
 
+static UWORD knob_step(KnobWidget* knob) {
+  return kKnobStepMin + ((knob->rotation * (kKnobStepMax - kKnobStepMin + 1)) / kKnobRotRange);
+}
+
 static VOID knob_render(Widget* widget) {
   KnobWidget* knob = (KnobWidget*)widget;
 
-  UWORD step = kKnobStepMin + ((knob->rotation * (kKnobStepMax - kKnobStepMin + 1)) / kKnobRotRange);
-
-  if (step != knob->last_render_step) {
-    knob->last_render_step = step;
-
-    for (UWORD i = 0; i < kBplDepth; ++ i) {
-      knob->bitmap.Planes[i] = (PLANEPTR)&KnobBpls[step][i][0];
-    }
+  knob->last_render_step = knob_step(knob);
 
-    BltBitMap(&knob->bitmap, 0, 0, ui_get_window()->RPort->BitMap,
-              widget->pos_tl[0], widget->pos_tl[1],
-              kKnobEdge, kKnobEdge, 0xC0, (1 << kBplDepth) - 1, NULL);
+  for (UWORD i = 0; i < kBplDepth; ++ i) {
+    knob->bitmap.Planes[i] = (PLANEPTR)&KnobBpls[knob->last_render_step][i][0];
   }
+
+  BltBitMap(&knob->bitmap, 0, 0, ui_get_window()->RPort->BitMap,
+            widget->pos_tl[0], widget->pos_tl[1],
+            kKnobEdge, kKnobEdge, 0xC0, (1 << kBplDepth) - 1, NULL);
 }
 
 static VOID knob_dragged(Widget* widget,
@@ -309,8 +343,12 @@ static VOID knob_dragged(Widget* widget,
   KnobWidget* knob = (KnobWidget*)widget;
 
   // Adjust knob rotation proportionally to vertical mouse movement.
+  // Only re-blit when the rotation crosses into a new knob image.
   knob->rotation = MAX(0, MIN(kKnobRotMax, knob->rotation - delta_y));
-  widget->render(widget);
+
+  if (knob_step(knob) != knob->last_render_step) {
+    widget->render(widget);
+  }
 
   // Calculate and propagate new knob value.
   WORD value = knob->value_min + (((knob->rotation * knob->value_scale) / kKnobRotRange) * knob->value_step);
@@ -611,3 +649,135 @@ BOOL widgets_make_wave(UWORD pos_x,
  cleanup:
   return ret;
 }
+
+static VOID custom_wave_render(Widget* widget) {
+  CustomWaveWidget* custom_wave = (CustomWaveWidget*)widget;
+  UWORD line_height = kCustomWaveHeight - 1 - kShadowGap;
+  WORD wave_lines[kCustomWavePoints][2];
+
+  // One vertex per point, wrapping back to the first point at the right edge.
+  for (UWORD i = 1; i < kCustomWavePoints; ++ i) {
+    wave_lines[i - 1][0] = i * kCustomWavePointWidth;
+    wave_lines[i - 1][1] = ((kWordMax >> kBitsPerByte) - custom_wave->points[i]) * line_height / kUByteMax;
+  }
+
+  wave_lines[kCustomWavePoints - 1][0] = kCustomWaveWidth - 1 - kShadowGap;
+  wave_lines[kCustomWavePoints - 1][1] = ((kWordMax >> kBitsPerByte) - custom_wave->points[0]) * line_height / kUByteMax;
+
+  BltClear((VOID*)CustomWaveBpls, sizeof(CustomWaveBpls), 1);
+
+  // Dotted zero line behind the wave.
+  SetAPen(&g.custom_wave_rport, kPenDark);
+  SetDrPt(&g.custom_wave_rport, 0xAAAA);
+  Move(&g.custom_wave_rport, 0, line_height / 2);
+  Draw(&g.custom_wave_rport, kCustomWaveWidth - 1 - kShadowGap, line_height / 2);
+
+  SetAPen(&g.custom_wave_rport, kPenColor);
+  SetDrPt(&g.custom_wave_rport, 0xFFFF);
+  Move(&g.custom_wave_rport, 0, wave_lines[kCustomWavePoints - 1][1]);
+  PolyDraw(&g.custom_wave_rport, ARRAY_SIZE(wave_lines), (WORD*)wave_lines);
+
+  // Create a shadow in the second bitplane.
+  struct BitMap shad_bmap = g.custom_wave_bmap;
+  shad_bmap.Planes[0] = (PLANEPTR)g.custom_wave_bmap.Planes[1];
+
+  WaitBlit();
+  BltBitMap(&g.custom_wave_bmap, 0, 0, &shad_bmap, 1, 1,
+            kCustomWaveWidth - 1, kCustomWaveHeight - 1, 0xE0, 1, NULL);
+
+  // Copy lines into the window.
+  BltBitMap(&g.custom_wave_bmap, 0, 0, ui_get_window()->RPort->BitMap,
+            widget->pos_tl[0], widget->pos_tl[1],
+            kCustomWaveWidth, kCustomWaveHeight, 0xC0, (1 << kBplDepth) - 1, NULL);
+}
+
+// Set every point the pen crossed horizontally to the pen height.
+static VOID custom_wave_pen_moved(Widget* widget,
+                                  UWORD from_x) {
+  CustomWaveWidget* custom_wave = (CustomWaveWidget*)widget;
+  UWORD from_point = from_x / (kCustomWavePointWidth * kCustomWavePenScale);
+  UWORD to_point = custom_wave->pen[0] / (kCustomWavePointWidth * kCustomWavePenScale);
+  BYTE value = (kWordMax >> kBitsPerByte) - ((custom_wave->pen[1] * (kUByteMax + 1)) / kCustomWavePenRangeY);
+  BOOL changed = FALSE;
+
+  for (UWORD point = MIN(from_point, to_point); point <= MAX(from_point, to_point); ++ point) {
+    if (custom_wave->points[point] != value) {
+      custom_wave->points[point] = value;
+      changed = TRUE;
+    }
+  }
+
+  if (changed) {
+    widget->render(widget);
+    custom_wave->value_changed(widget, custom_wave->points);
+  }
+}
+
+static VOID custom_wave_clicked(Widget* widget,
+                                UWORD mouse_rel[2]) {
+  CustomWaveWidget* custom_wave = (CustomWaveWidget*)widget;
+
+  for (UWORD i = 0; i < 2; ++ i) {
+    custom_wave->pen[i] = mouse_rel[i] * kCustomWavePenScale;
+  }
+
+  custom_wave_pen_moved(widget, custom_wave->pen[0]);
+}
+
+static VOID custom_wave_dragged(Widget* widget,
+                                WORD delta_x,
+                                WORD delta_y) {
+  CustomWaveWidget* custom_wave = (CustomWaveWidget*)widget;
+  UWORD from_x = custom_wave->pen[0];
+
+  custom_wave->pen[0] = MAX(0, MIN(kCustomWavePenRangeX - 1, (WORD)custom_wave->pen[0] + delta_x));
+  custom_wave->pen[1] = MAX(0, MIN(kCustomWavePenRangeY - 1, (WORD)custom_wave->pen[1] + delta_y));
+
+  custom_wave_pen_moved(widget, from_x);
+}
+
+static VOID custom_wave_released(Widget* widget,
+                                 UWORD out_rel[2]) {
+  CustomWaveWidget* custom_wave = (CustomWaveWidget*)widget;
+
+  for (UWORD i = 0; i < 2; ++ i) {
+    out_rel[i] = custom_wave->pen[i] / kCustomWavePenScale;
+  }
+}
+
+static VOID custom_wave_free(Widget* widget) {
+  FreeMem(widget, sizeof(CustomWaveWidget));
+}
+
+BOOL widgets_make_custom_wave(UWORD pos_x,
+                              UWORD pos_y,
+                              BYTE* points,
+                              VOID (*value_changed)(Widget* widget,
+                                                    BYTE* points),
+                              Widget** out_widget) {
+  BOOL ret = TRUE;
+
+  CustomWaveWidget custom_wave_widget = {
+    .widget = {
+      .pos_tl = { pos_x, pos_y },
+      .pos_br = { pos_x + kCustomWaveWidth - 1, pos_y + kCustomWaveHeight - 1 },
+      .render = custom_wave_render,
+      .clicked = custom_wave_clicked,
+      .released = custom_wave_released,
+      .dragged = custom_wave_dragged,
+      .free = custom_wave_free,
+    },
+    .pen = { 0, 0 },
+    .value_changed = value_changed,
+  };
+
+  CopyMem((APTR)points, (APTR)custom_wave_widget.points, sizeof(custom_wave_widget.points));
+
+  CHECK(*out_widget = (Widget*)AllocMem(sizeof(CustomWaveWidget), 0));
+  CopyMem((APTR)&custom_wave_widget, (APTR)*out_widget, sizeof(CustomWaveWidget));
+
+  value_changed(*out_widget, custom_wave_widget.points);
+
+cleanup:
+  return ret;
+}
@@ -52,6 +52,14 @@ typedef struct {
                         Wave osc2_wave);
 } WaveWidget;
 
+typedef struct {
+  Widget widget;
+  BYTE points[kCustomWavePoints];
+  UWORD pen[2];
+  VOID (*value_changed)(Widget* widget,
+                        BYTE* points);
+} CustomWaveWidget;
+
 BOOL widgets_init();
 VOID widgets_fini();
 BOOL widgets_make_knob(UWORD pos_x,
@@ -77,4 +85,10 @@ BOOL widgets_make_wave(UWORD pos_x,
                                              Wave osc1_wave,
                                              Wave osc2_wave),
                        Widget** out_widget);
+BOOL widgets_make_custom_wave(UWORD pos_x,
+                              UWORD pos_y,
+                              BYTE* points,
+                              VOID (*value_changed)(Widget* widget,
+                                                    BYTE* points),
+                              Widget** out_widget);
 #endif